@@ -91,6 +91,8 @@ MACRO(ADD_APP source_list)
     COMMAND ${CMAKE_COMMAND} -E copy "${CMAKE_CURRENT_SOURCE_DIR}/src/openfiledialog-txt.ps1" $<TARGET_FILE_DIR:${APP_NAME}>)
   add_custom_command(TARGET ${APP_NAME} POST_BUILD
     COMMAND ${CMAKE_COMMAND} -E copy "${CMAKE_CURRENT_SOURCE_DIR}/src/savefiledialog-txt.ps1" $<TARGET_FILE_DIR:${APP_NAME}>)
+  add_custom_command(TARGET ${APP_NAME} POST_BUILD
+    COMMAND ${CMAKE_COMMAND} -E copy "${CMAKE_CURRENT_SOURCE_DIR}/src/savefiledialog-mano.ps1" $<TARGET_FILE_DIR:${APP_NAME}>)
 
   if(${ENABLE_INSPECTOR})
     # Copy inspector to assets directory
@@ -0,0 +1,562 @@
+#include "Assembler.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+//The kinds of instructions that the assembler knows
+enum MnemonicKind : uint8_t {
+	MNEMONIC_MRI,		//Memory-reference instructions, followed by a symbolic address and maybe I
+	MNEMONIC_RRI,		//Register-reference and IO instructions, which have a fixed code
+	MNEMONIC_ORG,
+	MNEMONIC_HEX,
+	MNEMONIC_DEC,
+	MNEMONIC_END
+};
+
+//An instruction, its first three letters are packed the same way as a label
+struct Mnemonic {
+	uint32_t key;
+	MnemonicKind kind;
+	uint16_t code;
+};
+
+static constexpr uint32_t pack_mnemonic(const char *name) {
+	return uint32_t(uint8_t(name[0])) | (uint32_t(uint8_t(name[1])) << 8) | (uint32_t(uint8_t(name[2])) << 16);
+}
+
+//The opcode table
+static constexpr Mnemonic mnemonics[] = {
+	{pack_mnemonic("AND"), MNEMONIC_MRI, 0x0000},
+	{pack_mnemonic("ADD"), MNEMONIC_MRI, 0x1000},
+	{pack_mnemonic("LDA"), MNEMONIC_MRI, 0x2000},
+	{pack_mnemonic("STA"), MNEMONIC_MRI, 0x3000},
+	{pack_mnemonic("BUN"), MNEMONIC_MRI, 0x4000},
+	{pack_mnemonic("BSA"), MNEMONIC_MRI, 0x5000},
+	{pack_mnemonic("ISZ"), MNEMONIC_MRI, 0x6000},
+	{pack_mnemonic("CLA"), MNEMONIC_RRI, 0x7800},
+	{pack_mnemonic("CLE"), MNEMONIC_RRI, 0x7400},
+	{pack_mnemonic("CMA"), MNEMONIC_RRI, 0x7200},
+	{pack_mnemonic("CME"), MNEMONIC_RRI, 0x7100},
+	{pack_mnemonic("CIR"), MNEMONIC_RRI, 0x7080},
+	{pack_mnemonic("CIL"), MNEMONIC_RRI, 0x7040},
+	{pack_mnemonic("INC"), MNEMONIC_RRI, 0x7020},
+	{pack_mnemonic("SPA"), MNEMONIC_RRI, 0x7010},
+	{pack_mnemonic("SNA"), MNEMONIC_RRI, 0x7008},
+	{pack_mnemonic("SZA"), MNEMONIC_RRI, 0x7004},
+	{pack_mnemonic("SZE"), MNEMONIC_RRI, 0x7002},
+	{pack_mnemonic("HLT"), MNEMONIC_RRI, 0x7001},
+	{pack_mnemonic("INP"), MNEMONIC_RRI, 0xF800},
+	{pack_mnemonic("OUT"), MNEMONIC_RRI, 0xF400},
+	{pack_mnemonic("SKI"), MNEMONIC_RRI, 0xF200},
+	{pack_mnemonic("SKO"), MNEMONIC_RRI, 0xF100},
+	{pack_mnemonic("ION"), MNEMONIC_RRI, 0xF080},
+	{pack_mnemonic("IOF"), MNEMONIC_RRI, 0xF040},
+	{pack_mnemonic("ORG"), MNEMONIC_ORG, 0},
+	{pack_mnemonic("HEX"), MNEMONIC_HEX, 0},
+	{pack_mnemonic("DEC"), MNEMONIC_DEC, 0},
+	{pack_mnemonic("END"), MNEMONIC_END, 0}
+};
+
+//Find the instruction that the given string starts with (it must have at least 3 characters)
+//Returns nullptr if it isn't a known instruction
+static const Mnemonic *find_mnemonic(const std::string &instruction) {
+	uint32_t key = pack_mnemonic(instruction.c_str());
+	for (const Mnemonic &mnemonic : mnemonics)
+		if (mnemonic.key == key)
+			return &mnemonic;
+	return nullptr;
+}
+
+//Check whether the given string has a letter other than 0-9 or A-Z in the range [first, last)
+static bool has_non_alphanumeric(const std::string &s, size_t first, size_t last) {
+	return std::count_if(s.begin() + first, s.begin() + last, [](char c){return !(('0' <= c && c <= '9') || ('A' <= c && c <= 'Z'));}) > 0;
+}
+
+//Check whether the given string has a letter other than 0-9 or A-Z or space or minus(dash)
+static bool has_non_alphanumeric_or_space(const std::string &s) {
+	return std::count_if(s.begin(), s.end(), [](char c){return !(('0' <= c && c <= '9') || ('A' <= c && c <= 'Z') || c == ' ' || c == '-');}) > 0;
+}
+
+//Check whether the given string has a letter other than 0-9 or A-F, starting from index first
+static bool check_bad_HEX(const std::string &s, size_t first) {
+	return std::count_if(s.begin() + first, s.end(), [](char c){return !(('0' <= c && c <= '9') || ('A' <= c && c <= 'F'));}) > 0;
+}
+
+//Check whether the given string has a letter other than 0-9 or a minus(dash) at the beginning, starting from index first
+static bool check_bad_DEC(const std::string &s, size_t first) {
+	bool x = std::count_if(s.begin() + first, s.end(), [](char c){return !(('0' <= c && c <= '9') || c == '-');}) > 0;
+	bool y = std::count_if(s.begin() + first + 1, s.end(), [](char c){return !(('0' <= c && c <= '9'));}) > 0;
+	return x & y;
+}
+
+//Convert the given string to a number in the given base, the same way as std::stoi
+//Returns false instead of throwing if the string is not a number or is out of range
+static bool to_number(const char *s, int base, int &value) {
+	char *end;
+	errno = 0;
+	long result = strtol(s, &end, base);
+	if (end == s || errno == ERANGE || result > INT_MAX || result < INT_MIN)
+		return false;
+	value = int(result);
+	return true;
+}
+
+SymbolTable::SymbolTable() : entries_(256), size_(0) {}
+
+uint32_t SymbolTable::pack(const char *label, size_t length) {
+	uint32_t key = 0;
+	for (size_t i = 0; i < length && i < 3; i++)
+		key |= (uint32_t(uint8_t(label[i])) << (8 * i));
+	return key;
+}
+
+std::string SymbolTable::unpack(uint32_t key) {
+	std::string label;
+	for (; key != 0; key >>= 8)
+		label += char(key & 0xFF);
+	return label;
+}
+
+void SymbolTable::clear() {
+	std::fill(entries_.begin(), entries_.end(), Entry{0, 0});
+	size_ = 0;
+}
+
+bool SymbolTable::insert(uint32_t key, int address) {
+	//Keep the table at most half full, so that the probe sequences stay short
+	if (2 * (size_ + 1) > entries_.size())
+		grow();
+	size_t mask = entries_.size() - 1;
+	for (size_t index = (key * 2654435761u) & mask; ; index = (index + 1) & mask) {
+		if (entries_[index].key == key)
+			return false;
+		if (entries_[index].key == 0) {
+			entries_[index] = Entry{key, address};
+			size_++;
+			return true;
+		}
+	}
+}
+
+int SymbolTable::find(uint32_t key) const {
+	size_t mask = entries_.size() - 1;
+	for (size_t index = (key * 2654435761u) & mask; entries_[index].key != 0; index = (index + 1) & mask)
+		if (entries_[index].key == key)
+			return entries_[index].address;
+	return -1;
+}
+
+size_t SymbolTable::size() const {
+	return size_;
+}
+
+void SymbolTable::grow() {
+	std::vector<Entry> old_entries(entries_.size() * 2, Entry{0, 0});
+	old_entries.swap(entries_);
+	size_ = 0;
+	for (const Entry &entry : old_entries)
+		if (entry.key != 0)
+			insert(entry.key, entry.address);
+}
+
+bool parse_source_line(const char *line, size_t length, SourceLine &result) {
+	if (length == 0)
+		return false;
+	//Check whether a slash exists, if it does then separate the comment section
+	const char *slash = static_cast<const char *>(std::memchr(line, '/', length));
+	size_t code_length = (slash == nullptr ? length : size_t(slash - line));
+	result.comment.assign(line + code_length, length - code_length);
+	//All parts of the instruction, excluding the comment section, are capitalized in a single pass
+	//A space that is followed by another space and the illegal(useless) characters are dropped
+	result.label.clear();
+	result.instruction.clear();
+	bool has_label = false;
+	for (size_t i = 0; i < code_length; i++) {
+		char c = char(std::toupper(static_cast<unsigned char>(line[i])));
+		if (c == ' ' && i + 1 < code_length && line[i + 1] == ' ')
+			continue;
+		if (('0' > c || c > '9') && ('A' > c || c > 'Z') && c != ',' && c != ' ' && c != '-')
+			continue;
+		result.instruction.push_back(c);
+		//What has been read up to the first comma is the label, what's left of the line is the instruction itself
+		if (c == ',' && !has_label) {
+			result.label.swap(result.instruction);
+			has_label = true;
+		}
+	}
+	return true;
+}
+
+bool parse_source_line(const std::string &line, SourceLine &result) {
+	return parse_source_line(line.data(), line.size(), result);
+}
+
+SourceReader::SourceReader(const std::string &address) : begin_(0), end_(0), eof_(false) {
+	file_ = std::fopen(address.c_str(), "rb");
+}
+
+SourceReader::~SourceReader() {
+	if (file_ != nullptr)
+		std::fclose(file_);
+}
+
+bool SourceReader::is_open() const {
+	return file_ != nullptr;
+}
+
+bool SourceReader::next(const char *&line, size_t &length) {
+	carry_.clear();
+	while (true) {
+		const char *first = buffer_ + begin_;
+		const char *newline = static_cast<const char *>(std::memchr(first, '\n', end_ - begin_));
+		if (newline != nullptr) {
+			size_t size = size_t(newline - first);
+			begin_ += size + 1;
+			//A line that lies completely in the buffer is returned without a copy
+			if (carry_.empty()) {
+				line = first;
+				length = size;
+			}
+			else {
+				carry_.append(first, size);
+				line = carry_.data();
+				length = carry_.size();
+			}
+			break;
+		}
+		//The line continues in the next part of the file
+		carry_.append(first, end_ - begin_);
+		begin_ = end_ = 0;
+		if (!eof_ && file_ != nullptr) {
+			end_ = std::fread(buffer_, 1, sizeof(buffer_), file_);
+			eof_ = (end_ < sizeof(buffer_));
+		}
+		if (end_ == 0) {
+			//The last line doesn't have to end with a newline
+			if (carry_.empty())
+				return false;
+			line = carry_.data();
+			length = carry_.size();
+			break;
+		}
+	}
+	//The lines of files that were saved on Windows end with "\r\n"
+	if (length > 0 && line[length - 1] == '\r')
+		length--;
+	return true;
+}
+
+bool load_source_file(const std::string &address, std::vector<SourceLine> &lines, std::string &error_text, size_t max_lines) {
+	SourceReader reader(address);
+	if (!reader.is_open()) {
+		error_text = "Failed to load file.";
+		return false;
+	}
+	//The lines that are already in the vector are overwritten, so their strings keep their capacity
+	size_t count = 0;
+	const char *line;
+	size_t length;
+	while (reader.next(line, length)) {
+		if (count == lines.size())
+			lines.emplace_back();
+		if (!parse_source_line(line, length, lines[count]))
+			continue;
+		count++;
+		//Stop reading as soon as the file turns out to be too long
+		if (max_lines != 0 && count > max_lines) {
+			error_text = "The file contains more than " + std::to_string(max_lines) + " lines.";
+			lines.resize(max_lines);
+			return false;
+		}
+	}
+	lines.resize(count);
+	return true;
+}
+
+void encode_line(const SourceLine &line, EncodedLine &result, std::string &label, std::string &instruction) {
+	result = EncodedLine{EncodedLine::WORD, EncodedLine::NO_ERROR, nullptr, 0, 0, 0, 0};
+
+	if (!line.comment.empty() && line.comment[0] != '/') {
+		result.error_stage = EncodedLine::COMMENT_ERROR;
+		result.error = "Comments must start with '/'.";
+		return;
+	}
+	//The labels and instructions are capitalized, the comments are kept as they are
+	label.assign(line.label);
+	std::transform(label.begin(), label.end(), label.begin(), ::toupper);
+	instruction.assign(line.instruction);
+	std::transform(instruction.begin(), instruction.end(), instruction.begin(), ::toupper);
+	//Empty lines (and lines that only have a comment) don't take a memory word
+	if (label.empty() && instruction.empty()) {
+		result.kind = EncodedLine::EMPTY;
+		return;
+	}
+
+	if (!label.empty()) {
+		result.error_stage = EncodedLine::LABEL_ERROR;
+		if (label.back() != ',')
+			result.error = "Labels must end with ','.";
+		else if (instruction == "END" || (instruction.size() > 3 && instruction.compare(0, 3, "ORG") == 0))
+			result.error = "ORG and END instructions must not have labels.";
+		else if (label.size() > 4 || label.size() < 2 || has_non_alphanumeric(label, 0, label.size() - 1))
+			result.error = "Invalid label.";
+		else {
+			result.error_stage = EncodedLine::NO_ERROR;
+			result.label = SymbolTable::pack(label.c_str(), label.size() - 1);
+		}
+		if (result.error != nullptr)
+			return;
+	}
+
+	if (instruction.size() < 3 || has_non_alphanumeric_or_space(instruction)) {
+		result.error_stage = EncodedLine::SYNTAX_ERROR;
+		result.error = "Invalid instruction.";
+		return;
+	}
+	const Mnemonic *mnemonic = find_mnemonic(instruction);
+	if (mnemonic != nullptr && mnemonic->kind == MNEMONIC_END) {
+		result.kind = EncodedLine::END;
+		return;
+	}
+
+	//The errors that are found from here on are reported after checking the LC
+	result.error_stage = EncodedLine::INSTRUCTION_ERROR;
+	if (mnemonic == nullptr) {
+		result.error = (instruction.size() != 3 ? "A non-MRI instruction must have 3 characters." : "Invalid instruction.");
+		return;
+	}
+	switch (mnemonic->kind) {
+		case MNEMONIC_ORG: {
+			if (instruction.size() < 5 || instruction[3] != ' ' || has_non_alphanumeric(instruction, 4, instruction.size()) || !to_number(instruction.c_str() + 4, 16, result.org)) {
+				result.error = "Invalid ORG instruction.";
+				return;
+			}
+			result.kind = EncodedLine::ORG;
+			break;
+		}
+		case MNEMONIC_HEX: {
+			if (instruction.size() < 5 || instruction[3] != ' ') {
+				result.error = "Invalid HEX instruction.";
+				return;
+			}
+			int hex_value;
+			if (check_bad_HEX(instruction, 4) || !to_number(instruction.c_str() + 4, 16, hex_value)) {
+				result.error = "Invalid HEX number.";
+				return;
+			}
+			if (hex_value > 65535) {
+				result.error = "HEX number out of range.";
+				return;
+			}
+			result.word = uint16_t(hex_value);
+			break;
+		}
+		case MNEMONIC_DEC: {
+			if (instruction.size() < 5 || instruction[3] != ' ') {
+				result.error = "Invalid DEC instruction.";
+				return;
+			}
+			int dec_value;
+			if (check_bad_DEC(instruction, 4) || !to_number(instruction.c_str() + 4, 10, dec_value)) {
+				result.error = "Invalid DEC number.";
+				return;
+			}
+			if (32767 < dec_value || dec_value < -32768) {
+				result.error = "DEC number out of range.";
+				return;
+			}
+			result.word = uint16_t(dec_value);
+			break;
+		}
+		case MNEMONIC_MRI: {
+			//Each MRI has a three letter instruction, a space, a 1-3 letter symbolic address, and then maybe a space and I
+			//Therefor the second part which starts from index=4 is the symbolic address
+			size_t length = 0;
+			while (4 + length < instruction.size() && instruction[4 + length] != ' ')
+				length++;
+			if (9 < instruction.size() || instruction.size() < 5 || 3 < length || length < 1) {
+				result.error = "Invalid instruction.";
+				return;
+			}
+			if (isdigit(instruction[4])) {
+				result.error = "The second part of an MRI must be a symbolic address.";
+				return;
+			}
+			//Based on the size, check whether an I (indirect addressing) exists as it should
+			if (instruction.size() == 4 + length + 2 && instruction[instruction.size() - 2] == ' ' && instruction.back() == 'I')
+				result.word = uint16_t(0x8000 | mnemonic->code);
+			else if (instruction.size() == 4 + length)
+				result.word = mnemonic->code;
+			else {
+				result.error = "Invalid instruction.";
+				return;
+			}
+			//The address of the label is added to the last 12 bits by link
+			result.kind = EncodedLine::MRI;
+			result.symbol = SymbolTable::pack(instruction.c_str() + 4, length);
+			break;
+		}
+		case MNEMONIC_RRI:
+			if (instruction.size() != 3) {
+				result.error = "A non-MRI instruction must have 3 characters.";
+				return;
+			}
+			result.word = mnemonic->code;
+			break;
+		default:
+			break;
+	}
+	result.error_stage = EncodedLine::NO_ERROR;
+}
+
+bool link(const std::vector<EncodedLine> &lines, uint16_t memory[4096], SymbolTable &symbols, std::string &error_text, int *source_map) {
+	//A reference to a label that hasn't been defined yet, the address is added to the word at the end
+	struct Fixup {
+		int line, lc;
+		uint32_t key;
+	};
+	std::vector<Fixup> fixups;
+	//The line that wrote each memory word last, so that a word that was overwritten after an ORG isn't patched
+	int written_by[4096];
+	std::fill(written_by, written_by + 4096, -1);
+
+	//Clear the symbolic address table
+	symbols.clear();
+	//Clear the memory
+	std::memset(memory, 0, 4096 * sizeof(uint16_t));
+
+	error_text = "";
+
+	int line_count = int(lines.size());
+	int lc = -1;
+	for (int i = 0; i < line_count; i++) {
+		const EncodedLine &line = lines[i];
+		//The errors of a line are reported at the same point as the checks that need the other lines (e.g. an invalid
+		//label is reported before a redefined one, but an invalid instruction after it)
+		if (line.error_stage == EncodedLine::COMMENT_ERROR) {
+			error_text = "Line " + std::to_string(i) + ": " + line.error;
+			break;
+		}
+		if (line.kind == EncodedLine::EMPTY)
+			continue;
+		lc++;
+		if (line.error_stage == EncodedLine::LABEL_ERROR) {
+			error_text = "Line " + std::to_string(i) + ": " + line.error;
+			break;
+		}
+		if (line.label != 0 && !symbols.insert(line.label, lc)) {
+			error_text = "Line " + std::to_string(i) + ": Label redefined.";
+			break;
+		}
+		if (line.error_stage == EncodedLine::SYNTAX_ERROR) {
+			error_text = "Line " + std::to_string(i) + ": " + line.error;
+			break;
+		}
+		if (line.kind == EncodedLine::END)
+			break;
+		if (lc >= 4096) {
+			error_text = "Line " + std::to_string(i) + ": LC exceeded 4095.";
+			break;
+		}
+		if (line.error_stage == EncodedLine::INSTRUCTION_ERROR) {
+			error_text = "Line " + std::to_string(i) + ": " + line.error;
+			break;
+		}
+
+		if (line.kind == EncodedLine::ORG) {
+			lc = line.org - 1;
+			continue;
+		}
+		memory[lc] = line.word;
+		written_by[lc] = i;
+		//Save the address of the label in the last 12 bits, or patch it in later if the label isn't defined yet
+		if (line.kind == EncodedLine::MRI) {
+			int address = symbols.find(line.symbol);
+			if (address >= 0)
+				memory[lc] |= (address & 0x0FFF);
+			else
+				fixups.push_back(Fixup{i, lc, line.symbol});
+		}
+	}
+	//Patch the forward references
+	if (error_text.empty()) {
+		for (const Fixup &fixup : fixups) {
+			int address = symbols.find(fixup.key);
+			if (address < 0) {
+				error_text = "Line " + std::to_string(fixup.line) + ": Label not defined.";
+				break;
+			}
+			if (written_by[fixup.lc] == fixup.line)
+				memory[fixup.lc] |= (address & 0x0FFF);
+		}
+	}
+	if (source_map != nullptr)
+		std::copy(written_by, written_by + 4096, source_map);
+
+	return error_text.empty();
+}
+
+bool assemble(const std::vector<SourceLine> &lines, uint16_t memory[4096], SymbolTable &symbols, std::string &error_text, int *source_map) {
+	std::vector<EncodedLine> encoded(lines.size());
+	//The buffers for the capitalized label and instruction are reused for all of the lines
+	std::string label, instruction;
+	for (size_t i = 0; i < lines.size(); i++)
+		encode_line(lines[i], encoded[i], label, instruction);
+	return link(encoded, memory, symbols, error_text, source_map);
+}
+
+IncrementalAssembler::IncrementalAssembler(size_t line_count) : lines_(line_count), encoded_(line_count), row_is_dirty_(line_count, false) {
+	std::string label, instruction;
+	for (size_t i = 0; i < line_count; i++)
+		encode_line(lines_[i], encoded_[i], label, instruction);
+}
+
+const std::vector<SourceLine> &IncrementalAssembler::lines() const {
+	return lines_;
+}
+
+void IncrementalAssembler::set_line(size_t row, const SourceLine &line) {
+	//The new empty lines between the old end and this row have to be encoded too
+	if (row >= lines_.size()) {
+		size_t old_size = lines_.size();
+		lines_.resize(row + 1);
+		encoded_.resize(row + 1);
+		row_is_dirty_.resize(row + 1, false);
+		for (size_t i = old_size; i <= row; i++)
+			mark_dirty(i);
+	}
+	if (lines_[row].label == line.label && lines_[row].instruction == line.instruction && lines_[row].comment == line.comment)
+		return;
+	lines_[row] = line;
+	mark_dirty(row);
+}
+
+bool IncrementalAssembler::assemble(uint16_t memory[4096], SymbolTable &symbols, std::string &error_text, std::vector<int> &changed_words, int *source_map) {
+	//Encode the lines that have changed since the last call
+	for (size_t row : dirty_rows_) {
+		encode_line(lines_[row], encoded_[row], label_, instruction_);
+		row_is_dirty_[row] = false;
+	}
+	dirty_rows_.clear();
+
+	//Linking only looks at the encoded lines, so it's cheap enough to do for the whole program
+	if (!link(encoded_, image_, symbols, error_text, source_map))
+		return false;
+	for (int i = 0; i < 4096; i++) {
+		if (memory[i] != image_[i]) {
+			memory[i] = image_[i];
+			changed_words.push_back(i);
+		}
+	}
+	return true;
+}
+
+void IncrementalAssembler::mark_dirty(size_t row) {
+	if (!row_is_dirty_[row]) {
+		row_is_dirty_[row] = true;
+		dirty_rows_.push_back(row);
+	}
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//A line of code in the code table: a label, an instruction and a comment
+struct SourceLine {
+	std::string label, instruction, comment;
+};
+
+//Split a line of a txt source file into its label, instruction and comment sections, in a single pass over the line
+//All parts of the instruction, excluding the comment section, are capitalized and the illegal characters are removed
+//The strings of result are overwritten, so reusing the same result for many lines doesn't allocate
+//Returns false if the line is empty
+bool parse_source_line(const char *line, size_t length, SourceLine &result);
+bool parse_source_line(const std::string &line, SourceLine &result);
+
+//Reads a txt source file one line at a time through a fixed-size buffer, so a file of any size is read in linear time and
+//bounded memory
+class SourceReader {
+	public:
+		explicit SourceReader(const std::string &address);
+		~SourceReader();
+
+		SourceReader(const SourceReader &) = delete;
+		SourceReader &operator=(const SourceReader &) = delete;
+
+		//Whether the file could be opened
+		bool is_open() const;
+
+		//Get the next line (without its line break), which stays valid until the next call
+		//Returns false at the end of the file
+		bool next(const char *&line, size_t &length);
+
+	protected:
+		std::FILE *file_;
+		char buffer_[64 * 1024];
+		size_t begin_, end_;
+		bool eof_;
+		//A line that doesn't fit in the rest of the buffer is put together here
+		std::string carry_;
+};
+
+//Read a txt source file (the same format as the one the Load from txt button reads)
+//If the file has more than max_lines lines (0 means no limit), reading stops there
+//Returns false and sets error_text if the file can't be opened or is too long
+bool load_source_file(const std::string &address, std::vector<SourceLine> &lines, std::string &error_text, size_t max_lines = 0);
+
+//The symbolic address table
+//A label has 1-3 characters, so it's packed into an integer key (one byte per character), and the keys are stored in a flat
+//hash table with linear probing, which keeps its capacity when it's cleared
+class SymbolTable {
+	public:
+		SymbolTable();
+
+		//Pack the given label (1-3 characters) into a key
+		static uint32_t pack(const char *label, size_t length);
+
+		//The label that the given key was packed from
+		static std::string unpack(uint32_t key);
+
+		//Remove all of the labels
+		void clear();
+
+		//Add a label with the given address
+		//Returns false if the label already exists
+		bool insert(uint32_t key, int address);
+
+		//Returns the address of the given label, or -1 if it doesn't exist
+		int find(uint32_t key) const;
+
+		//The number of labels
+		size_t size() const;
+
+		//Call function(key, address) for each label, in no particular order
+		template <typename Function>
+		void for_each(Function &&function) const;
+
+	protected:
+		struct Entry {
+			uint32_t key;	//0 means that the entry is empty
+			int address;
+		};
+
+		//Double the capacity and reinsert all of the labels
+		void grow();
+
+		std::vector<Entry> entries_;
+		size_t size_;
+};
+
+template <typename Function>
+void SymbolTable::for_each(Function &&function) const {
+	for (const Entry &entry : entries_)
+		if (entry.key != 0)
+			function(entry.key, entry.address);
+}
+
+//A line of code that has been checked and encoded on its own, without the addresses of the labels that it references
+//Linking the encoded lines gives the same result as assembling the source, so a line only has to be encoded again when
+//its text changes
+struct EncodedLine {
+	enum Kind : uint8_t {
+		EMPTY,	//The line has no label and no instruction, so it doesn't take a memory word
+		WORD,	//A register-reference or IO instruction, HEX or DEC
+		MRI,	//A memory-reference instruction, symbol is the packed label that it references
+		ORG,
+		END
+	};
+	//When the error of the line is reported, relative to the checks that need the other lines
+	enum ErrorStage : uint8_t {
+		NO_ERROR,
+		COMMENT_ERROR,		//Before skipping an empty line
+		LABEL_ERROR,		//Before checking whether the label is redefined
+		SYNTAX_ERROR,		//Before END
+		INSTRUCTION_ERROR	//After checking the LC
+	};
+
+	Kind kind;
+	ErrorStage error_stage;
+	const char *error;	//e.g. "Invalid label."
+	uint32_t label;		//The packed label that the line defines (0 if it has none)
+	uint32_t symbol;
+	uint16_t word;		//The encoded word (without the address for an MRI)
+	int org;
+};
+
+//Check and encode a single line of code
+//label and instruction are buffers for the capitalized sections, so that they can be reused for many lines
+void encode_line(const SourceLine &line, EncodedLine &result, std::string &label, std::string &instruction);
+
+//Place the encoded lines in the memory and fill the symbolic address table in a single pass, the references to labels
+//that are defined later are patched at the end
+//If source_map is given, the line that each memory word has been assembled from is stored in it (-1 for the words that no
+//line has written)
+//Returns false and sets error_text (e.g. "Line 3: Label not defined.") if an error occurs
+bool link(const std::vector<EncodedLine> &lines, uint16_t memory[4096], SymbolTable &symbols, std::string &error_text, int *source_map = nullptr);
+
+//The assembler function
+//Assemble the given lines of code into the memory and fill the symbolic address table (and the source map, as in link)
+//Returns false and sets error_text (e.g. "Line 3: Label not defined.") if an error occurs
+bool assemble(const std::vector<SourceLine> &lines, uint16_t memory[4096], SymbolTable &symbols, std::string &error_text, int *source_map = nullptr);
+
+//An assembler that keeps its own copy of the source, which is updated one line at a time (e.g. whenever a row of the code
+//table is edited), and only encodes the lines that have changed since the last assembly again
+class IncrementalAssembler {
+	public:
+		explicit IncrementalAssembler(size_t line_count);
+
+		//The current source
+		const std::vector<SourceLine> &lines() const;
+
+		//Replace a line of the source, the source grows if the row is past its end
+		void set_line(size_t row, const SourceLine &line);
+
+		//Assemble the current source
+		//Only the memory words that differ from the assembled program are written, and their addresses are added to
+		//changed_words
+		//Returns false and sets error_text if an error occurs, the memory isn't changed in that case
+		bool assemble(uint16_t memory[4096], SymbolTable &symbols, std::string &error_text, std::vector<int> &changed_words, int *source_map = nullptr);
+
+	protected:
+		//Mark a line to be encoded again on the next assembly
+		void mark_dirty(size_t row);
+
+		std::vector<SourceLine> lines_;
+		std::vector<EncodedLine> encoded_;
+		std::vector<bool> row_is_dirty_;
+		std::vector<size_t> dirty_rows_;
+
+		//The buffers for encode_line
+		std::string label_, instruction_;
+
+		//The memory image of the last assembly
+		uint16_t image_[4096];
+};
@@ -0,0 +1,74 @@
+#include "Batch.h"
+#include "Assembler.h"
+#include "Devices.h"
+#include "Lockstep.h"
+#include "ThreadPool.h"
+#include <cstring>
+
+bool load_batch_program(const std::string &address, BatchProgram &program) {
+	program.name = address;
+	program.error_text = "";
+	std::memset(program.memory, 0, sizeof(program.memory));
+	std::vector<SourceLine> lines;
+	if (!load_source_file(address, lines, program.error_text))
+		return false;
+	SymbolTable symbols;
+	return assemble(lines, program.memory, symbols, program.error_text);
+}
+
+void run_with_input(Computer &computer, const std::vector<uint8_t> &input, uint64_t max_steps, BatchResult &result) {
+	Registers &registers = computer.registers;
+	IODevices devices;
+	devices.input.push(input.data(), input.size());
+	devices.attach(registers);
+	//Only INP and OUT clear FGI and FGO, so the program runs on the fast interpreter, which stops after them to let the
+	//devices be served before the next instruction
+	bool halt = false;
+	result.steps = 0;
+	while (!halt && (max_steps == 0 || result.steps < max_steps)) {
+		result.steps += computer.execute(max_steps == 0 ? UINT64_MAX : max_steps - result.steps, halt, true);
+		if (!registers.FGI || !registers.FGO)
+			devices.serve(registers);
+	}
+	result.reason = (halt ? StopReason::Halt : StopReason::StepLimit);
+	result.output = devices.output.bytes();
+	result.registers = registers;
+}
+
+std::vector<BatchResult> run_batch(const std::vector<BatchProgram> &programs, const std::vector<BatchInput> &inputs, uint64_t max_steps, size_t thread_count) {
+	std::vector<BatchResult> results(programs.size() * inputs.size());
+	if (inputs.empty())
+		return results;
+	ThreadPool pool(thread_count);
+	for (size_t p = 0; p < programs.size(); p++) {
+		for (size_t i = 0; i < inputs.size(); i++) {
+			BatchResult &result = results[p * inputs.size() + i];
+			result.program = p;
+			result.input = i;
+			result.error = !programs[p].error_text.empty();
+			result.reason = StopReason::Halt;
+			result.steps = 0;
+		}
+		if (!programs[p].error_text.empty())
+			continue;
+		//A program with many inputs is run on lockstep engines, LOCKSTEP_LANES inputs at a time
+		if (inputs.size() > 1) {
+			for (size_t first = 0; first < inputs.size(); first += LOCKSTEP_LANES) {
+				BatchResult *lane_results = &results[p * inputs.size() + first];
+				pool.submit([&programs, &inputs, p, first, max_steps, lane_results] {
+					run_lockstep_lanes(programs[p], inputs, first, max_steps, lane_results);
+				});
+			}
+			continue;
+		}
+		//Each run has its own computer, the programs and inputs are only read
+		BatchResult &result = results[p * inputs.size()];
+		pool.submit([&programs, &inputs, &result, max_steps] {
+			Computer computer;
+			std::memcpy(computer.memory, programs[result.program].memory, sizeof(computer.memory));
+			run_with_input(computer, inputs[result.input].bytes, max_steps, result);
+		});
+	}
+	pool.wait();
+	return results;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "Computer.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//A program of a batch, assembled once and then run with each of the inputs
+struct BatchProgram {
+	std::string name;
+	uint16_t memory[4096];
+	std::string error_text;	//Not empty if the program couldn't be loaded or assembled
+};
+
+//An input sequence of a batch: the bytes are given to the program through INPR, one at a time
+struct BatchInput {
+	std::string name;
+	std::vector<uint8_t> bytes;
+};
+
+//The result of running a program with an input
+struct BatchResult {
+	size_t program, input;	//Indices into the programs and inputs of the batch
+	bool error;				//The program couldn't be loaded or assembled, nothing was run
+	StopReason reason;
+	uint64_t steps;
+	std::vector<uint8_t> output;	//The bytes that the program wrote with OUT
+	Registers registers;			//The final registers
+};
+
+//Load and assemble a txt source file into a batch program
+//Returns false and sets program.error_text if the file can't be loaded or assembled
+bool load_batch_program(const std::string &address, BatchProgram &program);
+
+//Run a program with the given input until it halts or max_steps instructions are executed (0 means no limit)
+//The input and output devices are always ready: whenever FGI is clear, the next input byte (if there is one) is placed in
+//INPR and FGI is set, and whenever FGO is clear, OUTR is added to the output and FGO is set
+void run_with_input(Computer &computer, const std::vector<uint8_t> &input, uint64_t max_steps, BatchResult &result);
+
+//Run every program with every input on a pool of threads (0 means one thread for each core)
+//A program with more than one input is run on lockstep engines (see Lockstep.h), which give the same results as
+//run_with_input
+//The results are in the order of the programs and then the inputs
+std::vector<BatchResult> run_batch(const std::vector<BatchProgram> &programs, const std::vector<BatchInput> &inputs, uint64_t max_steps, size_t thread_count);
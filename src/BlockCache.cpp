@@ -0,0 +1,259 @@
+#include "BlockCache.h"
+#include "Decode.h"
+#include <cstring>
+
+//The operation of the entry that ends a block, after the operations of Decode.h
+#define BLOCK_END (OP_NOP + 1)
+
+BlockCache::BlockCache(Computer &computer) : computer_(computer), blocks_(4096) {
+	flush();
+}
+
+void BlockCache::flush() {
+	for (Block &block : blocks_)
+		block.valid = false;
+	std::memset(coverage_, 0, sizeof(coverage_));
+}
+
+BlockCache::Block &BlockCache::translate(int start) {
+	const uint8_t *operations = decode_table();
+	Block &block = blocks_[start];
+	block.valid = true;
+	block.length = 0;
+	for (int address = start; address < 4096 && block.length < MAX_BLOCK_LENGTH; address++) {
+		uint16_t word = computer_.memory[address];
+		uint8_t operation = operations[word];
+		block.entries[block.length] = Entry{word, uint16_t(word & ((1 << 12) - 1)), operation};
+		block.length++;
+		coverage_[address]++;
+		//The R flag can only be set by ION inside of a block, so it ends the block too
+		if (operation == OP_BUN || operation == OP_BSA || operation == OP_BUN_I || operation == OP_BSA_I ||
+			operation == OP_HLT || operation == OP_ION)
+			break;
+	}
+	block.entries[block.length] = Entry{0, 0, BLOCK_END};
+	return block;
+}
+
+void BlockCache::invalidate(int address) {
+	int first = (address >= MAX_BLOCK_LENGTH - 1 ? address - (MAX_BLOCK_LENGTH - 1) : 0);
+	for (int start = first; start <= address; start++) {
+		Block &block = blocks_[start];
+		if (block.valid && start + block.length > address) {
+			block.valid = false;
+			for (int i = start; i < start + block.length; i++)
+				coverage_[i]--;
+		}
+	}
+}
+
+uint64_t BlockCache::run_blocks(uint64_t max_steps, bool &halt) {
+	Registers &registers = computer_.registers;
+	uint16_t *memory = computer_.memory;
+	uint64_t steps = 0;
+	halt = false;
+
+	uint16_t ir = registers.IR, ac = registers.AC, dr = registers.DR, pc = (registers.PC & ((1 << 12) - 1)), ar = registers.AR;
+	bool e = registers.E, ien = registers.IEN, fgi = registers.FGI, fgo = registers.FGO;
+	uint8_t inpr = registers.INPR, outr = registers.OUTR;
+
+	//Every handler sets AR to its value at the end of the instruction, IR, I and MAR (which is always M[AR] after an
+	//instruction) are only set from the last instruction when the blocks are left
+#if THREADED_DISPATCH
+	static void *const handlers[] = {
+		&&HANDLER_OP_AND, &&HANDLER_OP_ADD, &&HANDLER_OP_LDA, &&HANDLER_OP_STA, &&HANDLER_OP_BUN, &&HANDLER_OP_BSA, &&HANDLER_OP_ISZ,
+		&&HANDLER_OP_AND_I, &&HANDLER_OP_ADD_I, &&HANDLER_OP_LDA_I, &&HANDLER_OP_STA_I, &&HANDLER_OP_BUN_I, &&HANDLER_OP_BSA_I, &&HANDLER_OP_ISZ_I,
+		&&HANDLER_OP_CLA, &&HANDLER_OP_CLE, &&HANDLER_OP_CMA, &&HANDLER_OP_CME, &&HANDLER_OP_CIR, &&HANDLER_OP_CIL, &&HANDLER_OP_INC,
+		&&HANDLER_OP_SPA, &&HANDLER_OP_SNA, &&HANDLER_OP_SZA, &&HANDLER_OP_SZE, &&HANDLER_OP_HLT,
+		&&HANDLER_OP_INP, &&HANDLER_OP_OUT, &&HANDLER_OP_SKI, &&HANDLER_OP_SKO, &&HANDLER_OP_ION, &&HANDLER_OP_IOF,
+		&&HANDLER_OP_NOP, &&HANDLER_BLOCK_END
+	};
+	#define HANDLER(operation) HANDLER_##operation:
+	#define DISPATCH() goto *handlers[entry->operation]
+#else
+	#define HANDLER(operation) case operation:
+	#define DISPATCH() goto dispatch
+#endif
+	#define NEXT() \
+		do { \
+			entry++; \
+			DISPATCH(); \
+		} while (0)
+	//The number of instructions of the block up to and including the current one
+	#define EXECUTED() uint16_t(entry - block->entries + 1)
+	//Write a word to the memory and invalidate the blocks that contain it
+	#define WRITE_MEMORY(address, value) \
+		do { \
+			memory[address] = (value); \
+			if (coverage_[address] != 0) \
+				invalidate(address); \
+		} while (0)
+
+	Block *block;
+	const Entry *entry;
+	uint16_t start;
+
+next_block:
+	start = pc;
+	block = &blocks_[start];
+	if (!block->valid)
+		block = &translate(start);
+	if (block->length > max_steps - steps)
+		goto finish;
+	entry = block->entries;
+
+#if THREADED_DISPATCH
+	DISPATCH();
+#else
+dispatch:
+	switch (entry->operation) {
+#endif
+
+	//Memory-reference instructions, the indirect ones load the effective address first
+	HANDLER(OP_AND) ar = entry->address; dr = memory[ar]; ac = (ac & dr); NEXT();
+	HANDLER(OP_AND_I) ar = (memory[entry->address] & ((1 << 12) - 1)); dr = memory[ar]; ac = (ac & dr); NEXT();
+	HANDLER(OP_ADD) ar = entry->address; dr = memory[ar]; ac = ac + dr; e = ((ac >> 15) & (dr >> 15)); NEXT();
+	HANDLER(OP_ADD_I) ar = (memory[entry->address] & ((1 << 12) - 1)); dr = memory[ar]; ac = ac + dr; e = ((ac >> 15) & (dr >> 15)); NEXT();
+	HANDLER(OP_LDA) ar = entry->address; dr = memory[ar]; ac = dr; NEXT();
+	HANDLER(OP_LDA_I) ar = (memory[entry->address] & ((1 << 12) - 1)); dr = memory[ar]; ac = dr; NEXT();
+	//A write to the current block ends it after this instruction
+	HANDLER(OP_STA) ar = entry->address; WRITE_MEMORY(ar, ac); if (!block->valid) goto leave; NEXT();
+	HANDLER(OP_STA_I) ar = (memory[entry->address] & ((1 << 12) - 1)); WRITE_MEMORY(ar, ac); if (!block->valid) goto leave; NEXT();
+	HANDLER(OP_ISZ) ar = entry->address; dr = memory[ar] + 1; WRITE_MEMORY(ar, dr); if (dr == 0) goto skip; if (!block->valid) goto leave; NEXT();
+	HANDLER(OP_ISZ_I) ar = (memory[entry->address] & ((1 << 12) - 1)); dr = memory[ar] + 1; WRITE_MEMORY(ar, dr); if (dr == 0) goto skip; if (!block->valid) goto leave; NEXT();
+	//The jumps end the block
+	HANDLER(OP_BUN) ar = entry->address; pc = ar; goto jump;
+	HANDLER(OP_BUN_I) ar = (memory[entry->address] & ((1 << 12) - 1)); pc = ar; goto jump;
+	HANDLER(OP_BSA) ar = entry->address; WRITE_MEMORY(ar, uint16_t(start + EXECUTED())); ar = ((ar + 1) & ((1 << 12) - 1)); pc = ar; goto jump;
+	HANDLER(OP_BSA_I) ar = (memory[entry->address] & ((1 << 12) - 1)); WRITE_MEMORY(ar, uint16_t(start + EXECUTED())); ar = ((ar + 1) & ((1 << 12) - 1)); pc = ar; goto jump;
+
+	//Register-reference instructions
+	HANDLER(OP_CLA) ar = entry->address; ac = 0; NEXT();
+	HANDLER(OP_CLE) ar = entry->address; e = 0; NEXT();
+	HANDLER(OP_CMA) ar = entry->address; ac = ~ac; NEXT();
+	HANDLER(OP_CME) ar = entry->address; e = !e; NEXT();
+	HANDLER(OP_CIR) ar = entry->address; { bool tmp = e; e = (ac & 1); ac = ((ac >> 1) | (uint16_t(tmp) << 15)); } NEXT();
+	HANDLER(OP_CIL) ar = entry->address; e = ((ac & (1 << 15)) >> 15); ac = ((ac << 1) | uint16_t(e)); NEXT();
+	HANDLER(OP_INC) ar = entry->address; ac = ac + 1; NEXT();
+	HANDLER(OP_SPA) ar = entry->address; if ((ac & (1 << 15)) == 0) goto skip; NEXT();
+	HANDLER(OP_SNA) ar = entry->address; if ((ac & (1 << 15)) != 0) goto skip; NEXT();
+	HANDLER(OP_SZA) ar = entry->address; if (ac == 0) goto skip; NEXT();
+	HANDLER(OP_SZE) ar = entry->address; if (e == 0) goto skip; NEXT();
+	HANDLER(OP_HLT)
+		ar = entry->address;
+		ir = entry->word;
+		steps += EXECUTED();
+		pc = uint16_t(start + EXECUTED() - 1);
+		halt = true;
+		goto finish;
+
+	//IO instructions
+	HANDLER(OP_INP) ar = entry->address; ac = inpr; fgi = 0; NEXT();
+	HANDLER(OP_OUT) ar = entry->address; outr = (ac & ((1 << 8) - 1)); fgo = 0; NEXT();
+	HANDLER(OP_SKI) ar = entry->address; if (fgi == 1) goto skip; NEXT();
+	HANDLER(OP_SKO) ar = entry->address; if (fgo == 1) goto skip; NEXT();
+	//ION can set the R flag, so the blocks are left to let the caller check it
+	HANDLER(OP_ION)
+		ar = entry->address;
+		ien = 1;
+		ir = entry->word;
+		steps += EXECUTED();
+		pc = ((start + EXECUTED()) & ((1 << 12) - 1));
+		goto finish;
+	HANDLER(OP_IOF) ar = entry->address; ien = 0; NEXT();
+	HANDLER(OP_NOP) ar = entry->address; NEXT();
+
+	//The end of a block without a jump continues at the next address
+	HANDLER(BLOCK_END)
+		entry--;
+		goto leave;
+
+#if !THREADED_DISPATCH
+	}
+#endif
+
+	//Leave the block after the current instruction, and continue at the next address, the one after it or the target of
+	//the jump
+leave:
+	ir = entry->word;
+	steps += EXECUTED();
+	pc = ((start + EXECUTED()) & ((1 << 12) - 1));
+	goto next_block;
+skip:
+	ir = entry->word;
+	steps += EXECUTED();
+	pc = ((start + EXECUTED() + 1) & ((1 << 12) - 1));
+	goto next_block;
+jump:
+	ir = entry->word;
+	steps += EXECUTED();
+	goto next_block;
+
+finish:
+	#undef HANDLER
+	#undef DISPATCH
+	#undef NEXT
+	#undef EXECUTED
+	#undef WRITE_MEMORY
+
+	if (steps == 0)
+		return 0;
+	registers.IR = ir;
+	registers.AC = ac;
+	registers.DR = dr;
+	registers.PC = pc;
+	registers.AR = ar;
+	registers.MAR = memory[ar];
+	registers.I = (ir >> 15);
+	registers.E = e;
+	registers.R = ien & (fgo | fgi);
+	registers.IEN = ien;
+	registers.FGI = fgi;
+	registers.FGO = fgo;
+	registers.INPR = inpr;
+	registers.OUTR = outr;
+	return steps;
+}
+
+uint64_t BlockCache::execute(uint64_t max_steps, bool &halt) {
+	Registers &registers = computer_.registers;
+	uint64_t steps = 0;
+	halt = false;
+	while (steps < max_steps && !halt) {
+		//Inside of the blocks, the R flag stays clear as long as it is clear at the start and the flags can't set it at the
+		//end of the first instruction (e.g. when FGI has been set from outside)
+		if (!registers.R && !(registers.IEN && (registers.FGO || registers.FGI))) {
+			uint64_t executed = run_blocks(max_steps - steps, halt);
+			steps += executed;
+			if (executed != 0)
+				continue;
+		}
+		//The interrupt cycle, the instructions that might be interrupted and a block that doesn't fit in the steps that are
+		//left are executed one at a time
+		std::pair<int, uint16_t> data_change;
+		halt = computer_.step(data_change);
+		steps++;
+		if (computer_.memory[data_change.first] != data_change.second && coverage_[data_change.first] != 0)
+			invalidate(data_change.first);
+	}
+	return steps;
+}
+
+StopReason BlockCache::run(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps) {
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(max_milliseconds);
+	steps = 0;
+	while (true) {
+		//Execute in chunks, so that the clock is only read once per chunk
+		uint64_t chunk = (max_milliseconds != 0 ? 65536 : UINT64_MAX);
+		if (max_steps != 0 && max_steps - steps < chunk)
+			chunk = max_steps - steps;
+		bool halt;
+		steps += execute(chunk, halt);
+		if (halt)
+			return StopReason::Halt;
+		if (max_steps != 0 && steps >= max_steps)
+			return StopReason::StepLimit;
+		if (max_milliseconds != 0 && std::chrono::steady_clock::now() >= deadline)
+			return StopReason::TimeLimit;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "Computer.h"
+#include <cstdint>
+#include <vector>
+
+//The maximum number of instructions in a translated block
+#define MAX_BLOCK_LENGTH 32
+
+//A translation cache for running a computer: straight-line runs of instructions are decoded once into blocks, which are
+//then executed without fetching and decoding each word again
+//A block ends after a jump (BUN or BSA), HLT or ION, or after MAX_BLOCK_LENGTH instructions. ISZ and the skip
+//instructions leave the block when they skip, so a loop that is counted by ISZ is one block with its closing BUN
+//Inside of a block, the operands are decoded, the PC is only set when the block is left and the step limit and the R flag
+//are checked once for the whole block. A block is chained to the next one as long as the R flag stays clear (that is,
+//until ION), and the instructions that have to check the flags (the interrupts, and IEN with FGI or FGO set) are run
+//with Computer::step
+//Writes to the memory by STA, BSA, ISZ and the interrupt cycle invalidate the blocks that contain the written word, so
+//self-modifying programs behave exactly like they do with Computer::step
+class BlockCache {
+	public:
+		explicit BlockCache(Computer &computer);
+
+		//Drop all of the translated blocks
+		//This must be called whenever the memory of the computer is changed from outside of this class (e.g. after
+		//assembling a program or restoring a state from the history)
+		void flush();
+
+		//Execute at most max_steps instructions (or interrupt cycles), the same as Computer::execute
+		//halt is set to true if the computer has halted
+		//Returns the number of executed steps
+		uint64_t execute(uint64_t max_steps, bool &halt);
+
+		//Execute instructions until the computer halts or one of the limits is reached (a limit of 0 means no limit)
+		//The number of executed instructions is stored in steps
+		StopReason run(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps);
+
+	protected:
+		//A decoded instruction of a block: its word, its address part and its operation (see Decode.h)
+		struct Entry {
+			uint16_t word, address;
+			uint8_t operation;
+		};
+
+		//The instructions of a block are followed by an entry that leaves the block at the next address
+		struct Block {
+			bool valid;
+			uint8_t length;
+			Entry entries[MAX_BLOCK_LENGTH + 1];
+		};
+
+		//Execute chained blocks until the computer halts, executes ION or the next block doesn't fit in max_steps
+		//The R flag must be clear and the flags must not be able to set it at the end of the first instruction
+		//Returns the number of executed steps, which is 0 if the first block doesn't fit
+		uint64_t run_blocks(uint64_t max_steps, bool &halt);
+
+		//Decode the block that starts at the given address
+		Block &translate(int start);
+
+		//Invalidate all of the blocks that contain the given address
+		void invalidate(int address);
+
+		Computer &computer_;
+
+		//The blocks, indexed by their starting address
+		std::vector<Block> blocks_;
+
+		//The number of valid blocks that contain each address, so that writes to data words are cheap to check
+		uint8_t coverage_[4096];
+};
@@ -0,0 +1,37 @@
+#include "Breakpoints.h"
+#include <cstring>
+
+Breakpoints::Breakpoints() {
+	clear();
+}
+
+void Breakpoints::set(BreakpointKind kind, int address, bool enabled) {
+	if (has(kind, address) == enabled)
+		return;
+	bits_[kind][address >> 6] ^= (uint64_t(1) << (address & 63));
+	if (enabled)
+		counts_[kind]++;
+	else
+		counts_[kind]--;
+}
+
+void Breakpoints::clear() {
+	std::memset(bits_, 0, sizeof(bits_));
+	std::memset(counts_, 0, sizeof(counts_));
+	conditions_.clear();
+}
+
+void Breakpoints::add_condition(const Condition &condition) {
+	conditions_.push_back(condition);
+}
+
+void Breakpoints::clear_conditions() {
+	conditions_.clear();
+}
+
+int Breakpoints::true_condition(const Registers &before, const Registers &after, const uint16_t *memory) const {
+	for (size_t i = 0; i < conditions_.size(); i++)
+		if (conditions_[i].evaluate(before, after, memory))
+			return int(i);
+	return -1;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "Condition.h"
+#include <cstddef>
+#include <cstdint>
+
+//The kinds of breakpoints: an execute breakpoint stops before the instruction at its address is executed, a read or write
+//watchpoint stops after an instruction has read or written the word at its address
+enum BreakpointKind : uint8_t {
+	BREAK_EXECUTE,
+	BREAK_READ,
+	BREAK_WRITE
+};
+
+//The breakpoints and watchpoints of the 4096 memory words, stored as one bitmap of each kind, and the conditional breakpoints
+//Checking an address is a single bit test, and a run without any breakpoints doesn't check anything (see Computer::run)
+class Breakpoints {
+	public:
+		Breakpoints();
+
+		//Set or remove a breakpoint
+		void set(BreakpointKind kind, int address, bool enabled);
+
+		//Remove all of the breakpoints, including the conditional ones
+		void clear();
+
+		//Add a conditional breakpoint, which stops a run after a step that has made its condition true
+		void add_condition(const Condition &condition);
+
+		//Remove all of the conditional breakpoints
+		void clear_conditions();
+
+		//The conditional breakpoints, in the order that they have been added
+		const std::vector<Condition> &conditions() const { return conditions_; }
+
+		//The index of the first condition that holds after a step (-1 if none holds)
+		int true_condition(const Registers &before, const Registers &after, const uint16_t *memory) const;
+
+		//Check whether a breakpoint is set
+		bool has(BreakpointKind kind, int address) const {
+			return (bits_[kind][address >> 6] >> (address & 63)) & 1;
+		}
+
+		//The number of breakpoints of a kind
+		size_t count(BreakpointKind kind) const { return counts_[kind]; }
+
+		//Whether no breakpoints of any kind are set
+		bool empty() const { return counts_[BREAK_EXECUTE] + counts_[BREAK_READ] + counts_[BREAK_WRITE] == 0 && conditions_.empty(); }
+
+	protected:
+		uint64_t bits_[3][64];
+		size_t counts_[3];
+		std::vector<Condition> conditions_;
+};
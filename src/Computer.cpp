@@ -0,0 +1,487 @@
+#include "Computer.h"
+#include "Decode.h"
+#include <cstring>
+
+struct DecodeTable {
+	uint8_t operations[65536];
+
+	DecodeTable() {
+		for (int word = 0; word < 65536; word++) {
+			int opcode = ((word & ((1 << 15) - 1)) >> 12);
+			if (opcode != 7)
+				operations[word] = uint8_t((word >> 15) ? OP_AND_I + opcode : OP_AND + opcode);
+			else
+				operations[word] = OP_NOP;
+		}
+		operations[0x7800] = OP_CLA;
+		operations[0x7400] = OP_CLE;
+		operations[0x7200] = OP_CMA;
+		operations[0x7100] = OP_CME;
+		operations[0x7080] = OP_CIR;
+		operations[0x7040] = OP_CIL;
+		operations[0x7020] = OP_INC;
+		operations[0x7010] = OP_SPA;
+		operations[0x7008] = OP_SNA;
+		operations[0x7004] = OP_SZA;
+		operations[0x7002] = OP_SZE;
+		operations[0x7001] = OP_HLT;
+		operations[0xF800] = OP_INP;
+		operations[0xF400] = OP_OUT;
+		operations[0xF200] = OP_SKI;
+		operations[0xF100] = OP_SKO;
+		operations[0xF080] = OP_ION;
+		operations[0xF040] = OP_IOF;
+	}
+};
+
+const uint8_t *decode_table() {
+	static const DecodeTable table;
+	return table.operations;
+}
+
+//The mnemonic of each operation, in the order of the Operation enum
+static const char *const operation_names[] = {
+	"AND", "ADD", "LDA", "STA", "BUN", "BSA", "ISZ",
+	"AND I", "ADD I", "LDA I", "STA I", "BUN I", "BSA I", "ISZ I",
+	"CLA", "CLE", "CMA", "CME", "CIR", "CIL", "INC", "SPA", "SNA", "SZA", "SZE", "HLT",
+	"INP", "OUT", "SKI", "SKO", "ION", "IOF",
+	"NOP"
+};
+
+const char *operation_name(int operation) {
+	return operation_names[operation];
+}
+
+Computer::Computer() {
+	reset();
+}
+
+void Computer::reset() {
+	std::memset(memory, 0, sizeof(memory));
+	reset_registers();
+}
+
+void Computer::reset_registers() {
+	std::memset(&registers, 0, sizeof(registers));
+}
+
+bool Computer::step(std::pair<int, uint16_t> &data_change) {
+	//A flag that becomes true when the computer halts
+	bool halt = false;
+
+	//Work on local copies of the registers, so that the compiler can keep them in machine registers
+	uint16_t ir = registers.IR, ac = registers.AC, dr = registers.DR, pc = registers.PC, ar = registers.AR, mar = registers.MAR, tr = registers.TR;
+	bool i = registers.I, e = registers.E, r = registers.R, ien = registers.IEN, fgi = registers.FGI, fgo = registers.FGO;
+	uint8_t inpr = registers.INPR, outr = registers.OUTR;
+
+	//If the R flag is true, run the interrupt cycle
+	if (r) {
+		ar = 0;
+		tr = pc;
+		data_change = std::make_pair(ar, memory[ar]);
+		memory[ar] = tr;
+		mar = memory[ar];
+		pc = 0;
+		pc = pc + 1;
+		ien = 0;
+		r = 0;
+	}
+	//If the R flag is false, run the instruction cycle
+	else {
+		//Fetch and decode
+		ar = (pc & ((1 << 12) - 1));
+		mar = memory[ar];
+
+		ir = mar;
+		pc = pc + 1;
+
+		int opcode = ((ir & ((1 << 15) - 1)) >> 12);
+		ar = (ir & ((1 << 12) - 1));
+		mar = memory[ar];
+		i = (ir >> 15);
+
+		//Execute register-reference instruction (starts with 7) or IO instruction (starts with F)
+		if (opcode == 7) {
+			//These instructions don't change the memory
+			data_change = std::make_pair(ar, memory[ar]);
+			switch(ir) {
+				case 0x7800: {
+					ac = 0;
+					break;
+				}
+				case 0x7400: {
+					e = 0;
+					break;
+				}
+				case 0x7200: {
+					ac = ~ac;
+					break;
+				}
+				case 0x7100: {
+					e = !e;
+					break;
+				}
+				case 0x7080: {
+					bool tmp = e;
+					e = (ac & 1);
+					ac = ((ac >> 1) | (uint16_t(tmp) << 15));
+					break;
+				}
+				case 0x7040: {
+					e = ((ac & (1 << 15)) >> 15);
+					ac = ((ac << 1) | uint16_t(e));
+					break;
+				}
+				case 0x7020: {
+					ac = ac + 1;
+					break;
+				}
+				case 0x7010: {
+					if ((ac & (1 << 15)) == 0)
+						pc = pc + 1;
+					break;
+				}
+				case 0x7008: {
+					if ((ac & (1 << 15)) != 0)
+						pc = pc + 1;
+					break;
+				}
+				case 0x7004: {
+					if (ac == 0)
+						pc = pc + 1;
+					break;
+				}
+				case 0x7002: {
+					if (e == 0)
+						pc = pc + 1;
+					break;
+				}
+				case 0x7001: {
+					halt = true;
+					break;
+				}
+				case 0xF800: {
+					ac = inpr;
+					fgi = 0;
+					break;
+				}
+				case 0xF400: {
+					outr = (ac & ((1 << 8) - 1));
+					fgo = 0;
+					break;
+				}
+				case 0xF200: {
+					if (fgi == 1)
+						pc = pc + 1;
+					break;
+				}
+				case 0xF100: {
+					if (fgo == 1)
+						pc = pc + 1;
+					break;
+				}
+				case 0xF080: {
+					ien = 1;
+					break;
+				}
+				case 0xF040: {
+					ien = 0;
+					break;
+				}
+			}
+		}
+		//Execute memory-reference instruction
+		else {
+			if (i) {
+				ar = (mar & ((1 << 12) - 1));
+				mar = memory[ar];
+			}
+			//Save the data that might be changed in the current execution along with its (effective) address
+			data_change = std::make_pair(ar, memory[ar]);
+			switch (opcode) {
+				case 0b000: {
+					dr = mar;
+					ac = (ac & dr);
+					break;
+				}
+				case 0b001: {
+					dr = mar;
+					ac = ac + dr;
+					e = ((ac >> 15) & (dr >> 15));
+					break;
+				}
+				case 0b010: {
+					dr = mar;
+					ac = dr;
+					break;
+				}
+				case 0b011: {
+					memory[ar] = ac;
+					mar = memory[ar];
+					break;
+				}
+				case 0b100: {
+					pc = ar;
+					break;
+				}
+				case 0b101: {
+					memory[ar] = pc;
+					ar = ((ar + 1) & ((1 << 12) - 1));
+					mar = memory[ar];
+					pc = ar;
+					break;
+				}
+				case 0b110: {
+					dr = mar;
+					dr = dr + 1;
+					memory[ar] = dr;
+					mar = memory[ar];
+					if (dr == 0)
+						pc = pc + 1;
+					break;
+				}
+			}
+		}
+	}
+	//Check the conditions for the R flag
+	r = ien & (fgo | fgi);
+	//If the computer has halted, then the PC register shouldn't be incremented
+	if (halt)
+		pc = pc - 1;
+	//The PC register is 12 bits wide, so it must stay inside the memory
+	pc = (pc & ((1 << 12) - 1));
+
+	//Store the new register values
+	registers.IR = ir;
+	registers.AC = ac;
+	registers.DR = dr;
+	registers.PC = pc;
+	registers.AR = ar;
+	registers.MAR = mar;
+	registers.TR = tr;
+	registers.I = i;
+	registers.E = e;
+	registers.R = r;
+	registers.IEN = ien;
+	registers.FGI = fgi;
+	registers.FGO = fgo;
+	registers.INPR = inpr;
+	registers.OUTR = outr;
+
+	return halt;
+}
+
+uint64_t Computer::execute(uint64_t max_steps, bool &halt, bool stop_after_io) {
+	const uint8_t *operations = decode_table();
+	uint64_t steps = 0;
+	halt = false;
+
+	uint16_t ir = registers.IR, ac = registers.AC, dr = registers.DR, pc = registers.PC, ar = registers.AR, mar = registers.MAR, tr = registers.TR;
+	bool i = registers.I, e = registers.E, r = registers.R, ien = registers.IEN, fgi = registers.FGI, fgo = registers.FGO;
+	uint8_t inpr = registers.INPR, outr = registers.OUTR;
+
+	//Each handler finishes its step with END_STEP, which checks the conditions for the R flag, keeps the PC register inside
+	//the memory, and then fetches and dispatches the next instruction
+#if THREADED_DISPATCH
+	static void *const handlers[] = {
+		&&HANDLER_OP_AND, &&HANDLER_OP_ADD, &&HANDLER_OP_LDA, &&HANDLER_OP_STA, &&HANDLER_OP_BUN, &&HANDLER_OP_BSA, &&HANDLER_OP_ISZ,
+		&&HANDLER_OP_AND_I, &&HANDLER_OP_ADD_I, &&HANDLER_OP_LDA_I, &&HANDLER_OP_STA_I, &&HANDLER_OP_BUN_I, &&HANDLER_OP_BSA_I, &&HANDLER_OP_ISZ_I,
+		&&HANDLER_OP_CLA, &&HANDLER_OP_CLE, &&HANDLER_OP_CMA, &&HANDLER_OP_CME, &&HANDLER_OP_CIR, &&HANDLER_OP_CIL, &&HANDLER_OP_INC,
+		&&HANDLER_OP_SPA, &&HANDLER_OP_SNA, &&HANDLER_OP_SZA, &&HANDLER_OP_SZE, &&HANDLER_OP_HLT,
+		&&HANDLER_OP_INP, &&HANDLER_OP_OUT, &&HANDLER_OP_SKI, &&HANDLER_OP_SKO, &&HANDLER_OP_ION, &&HANDLER_OP_IOF,
+		&&HANDLER_OP_NOP
+	};
+	#define HANDLER(operation) HANDLER_##operation:
+	#define DISPATCH() \
+		do { \
+			if (steps == max_steps) \
+				goto finish; \
+			if (r) \
+				goto interrupt; \
+			ar = (pc & ((1 << 12) - 1)); \
+			ir = memory[ar]; \
+			pc = pc + 1; \
+			ar = (ir & ((1 << 12) - 1)); \
+			mar = memory[ar]; \
+			i = (ir >> 15); \
+			goto *handlers[operations[ir]]; \
+		} while (0)
+	#define END_STEP() \
+		do { \
+			r = ien & (fgo | fgi); \
+			pc = (pc & ((1 << 12) - 1)); \
+			steps++; \
+			DISPATCH(); \
+		} while (0)
+
+	DISPATCH();
+#else
+	#define HANDLER(operation) case operation:
+	#define END_STEP() goto end_step
+
+	while (true) {
+		if (steps == max_steps)
+			goto finish;
+		if (r)
+			goto interrupt;
+		ar = (pc & ((1 << 12) - 1));
+		ir = memory[ar];
+		pc = pc + 1;
+		ar = (ir & ((1 << 12) - 1));
+		mar = memory[ar];
+		i = (ir >> 15);
+		switch (operations[ir]) {
+#endif
+
+	//Memory-reference instructions with indirect addressing load the effective address first
+	HANDLER(OP_AND_I) ar = (mar & ((1 << 12) - 1)); mar = memory[ar];
+	HANDLER(OP_AND) dr = mar; ac = (ac & dr); END_STEP();
+	HANDLER(OP_ADD_I) ar = (mar & ((1 << 12) - 1)); mar = memory[ar];
+	HANDLER(OP_ADD) dr = mar; ac = ac + dr; e = ((ac >> 15) & (dr >> 15)); END_STEP();
+	HANDLER(OP_LDA_I) ar = (mar & ((1 << 12) - 1)); mar = memory[ar];
+	HANDLER(OP_LDA) dr = mar; ac = dr; END_STEP();
+	HANDLER(OP_STA_I) ar = (mar & ((1 << 12) - 1));
+	HANDLER(OP_STA) memory[ar] = ac; mar = ac; END_STEP();
+	HANDLER(OP_BUN_I) ar = (mar & ((1 << 12) - 1)); mar = memory[ar];
+	HANDLER(OP_BUN) pc = ar; END_STEP();
+	HANDLER(OP_BSA_I) ar = (mar & ((1 << 12) - 1));
+	HANDLER(OP_BSA) memory[ar] = pc; ar = ((ar + 1) & ((1 << 12) - 1)); mar = memory[ar]; pc = ar; END_STEP();
+	HANDLER(OP_ISZ_I) ar = (mar & ((1 << 12) - 1)); mar = memory[ar];
+	HANDLER(OP_ISZ) dr = mar + 1; memory[ar] = dr; mar = dr; if (dr == 0) pc = pc + 1; END_STEP();
+
+	//Register-reference instructions
+	HANDLER(OP_CLA) ac = 0; END_STEP();
+	HANDLER(OP_CLE) e = 0; END_STEP();
+	HANDLER(OP_CMA) ac = ~ac; END_STEP();
+	HANDLER(OP_CME) e = !e; END_STEP();
+	HANDLER(OP_CIR) { bool tmp = e; e = (ac & 1); ac = ((ac >> 1) | (uint16_t(tmp) << 15)); } END_STEP();
+	HANDLER(OP_CIL) e = ((ac & (1 << 15)) >> 15); ac = ((ac << 1) | uint16_t(e)); END_STEP();
+	HANDLER(OP_INC) ac = ac + 1; END_STEP();
+	HANDLER(OP_SPA) if ((ac & (1 << 15)) == 0) pc = pc + 1; END_STEP();
+	HANDLER(OP_SNA) if ((ac & (1 << 15)) != 0) pc = pc + 1; END_STEP();
+	HANDLER(OP_SZA) if (ac == 0) pc = pc + 1; END_STEP();
+	HANDLER(OP_SZE) if (e == 0) pc = pc + 1; END_STEP();
+	HANDLER(OP_HLT)
+		r = ien & (fgo | fgi);
+		pc = ((pc - 1) & ((1 << 12) - 1));
+		steps++;
+		halt = true;
+		goto finish;
+
+	//IO instructions
+	HANDLER(OP_INP) ac = inpr; fgi = 0; if (stop_after_io) goto io; END_STEP();
+	HANDLER(OP_OUT) outr = (ac & ((1 << 8) - 1)); fgo = 0; if (stop_after_io) goto io; END_STEP();
+	HANDLER(OP_SKI) if (fgi == 1) pc = pc + 1; END_STEP();
+	HANDLER(OP_SKO) if (fgo == 1) pc = pc + 1; END_STEP();
+	HANDLER(OP_ION) ien = 1; END_STEP();
+	HANDLER(OP_IOF) ien = 0; END_STEP();
+	HANDLER(OP_NOP) END_STEP();
+
+#if !THREADED_DISPATCH
+		}
+	end_step:
+		r = ien & (fgo | fgi);
+		pc = (pc & ((1 << 12) - 1));
+		steps++;
+	}
+#endif
+
+	//The interrupt cycle
+interrupt:
+	ar = 0;
+	tr = pc;
+	memory[ar] = tr;
+	mar = memory[ar];
+	pc = 1;
+	ien = 0;
+	r = 0;
+	END_STEP();
+
+	//The end of the step of INP or OUT, when the devices are served by the caller
+io:
+	r = ien & (fgo | fgi);
+	pc = (pc & ((1 << 12) - 1));
+	steps++;
+
+finish:
+	registers.IR = ir;
+	registers.AC = ac;
+	registers.DR = dr;
+	registers.PC = pc;
+	registers.AR = ar;
+	registers.MAR = mar;
+	registers.TR = tr;
+	registers.I = i;
+	registers.E = e;
+	registers.R = r;
+	registers.IEN = ien;
+	registers.FGI = fgi;
+	registers.FGO = fgo;
+	registers.INPR = inpr;
+	registers.OUTR = outr;
+
+	#undef HANDLER
+	#undef END_STEP
+	#undef DISPATCH
+
+	return steps;
+}
+
+StopReason Computer::run(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps) {
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(max_milliseconds);
+	steps = 0;
+	while (true) {
+		//Execute in chunks, so that the clock is only read once per chunk
+		uint64_t chunk = (max_milliseconds != 0 ? 65536 : UINT64_MAX);
+		if (max_steps != 0 && max_steps - steps < chunk)
+			chunk = max_steps - steps;
+		bool halt;
+		steps += execute(chunk, halt);
+		if (halt)
+			return StopReason::Halt;
+		if (max_steps != 0 && steps >= max_steps)
+			return StopReason::StepLimit;
+		if (max_milliseconds != 0 && std::chrono::steady_clock::now() >= deadline)
+			return StopReason::TimeLimit;
+	}
+}
+
+StopReason Computer::run_with_breakpoints(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps, const Breakpoints &breakpoints) {
+	//Without breakpoints, the fast interpreter is used
+	if (breakpoints.empty())
+		return run(max_steps, max_milliseconds, steps);
+	return run_with_breakpoints(max_steps, max_milliseconds, steps, breakpoints, [](const std::pair<int, uint16_t> &, bool) {});
+}
+
+int Computer::watched_address(bool interrupt, const std::pair<int, uint16_t> &data_change, const Breakpoints &breakpoints) const {
+	//The interrupt cycle writes the return address to 0
+	if (interrupt)
+		return breakpoints.has(BREAK_WRITE, 0) ? 0 : -1;
+	uint8_t operation = decode_table()[registers.IR];
+	if (operation >= OP_CLA)
+		return -1;
+	//An indirect instruction reads its effective address from the word that it refers to
+	int pointer = (registers.IR & ((1 << 12) - 1));
+	if (operation >= OP_AND_I && breakpoints.has(BREAK_READ, pointer))
+		return pointer;
+	//The memory-reference instructions report their effective address in data_change
+	int address = data_change.first;
+	bool read = false, write = false;
+	switch (operation % (OP_ISZ + 1)) {
+		case OP_AND:
+		case OP_ADD:
+		case OP_LDA:
+			read = true;
+			break;
+		case OP_STA:
+		case OP_BSA:
+			write = true;
+			break;
+		case OP_ISZ:
+			read = write = true;
+			break;
+	}
+	if ((read && breakpoints.has(BREAK_READ, address)) || (write && breakpoints.has(BREAK_WRITE, address)))
+		return address;
+	return -1;
+}
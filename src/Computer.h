@@ -0,0 +1,127 @@
+#pragma once
+#include "Breakpoints.h"
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+//The registers in the Basic computer
+struct Registers {
+	uint16_t IR, AC, DR, PC, AR, MAR, TR;
+	bool I, E, R, IEN, FGI, FGO;
+	uint8_t INPR, OUTR;
+};
+
+//The reason why a run of the computer stopped
+enum class StopReason {
+	Halt,		//A HLT instruction has been executed
+	StepLimit,	//The maximum number of instructions has been executed
+	TimeLimit,	//The time budget has run out
+	Breakpoint	//A breakpoint or a watchpoint has been hit
+};
+
+//The Basic computer: a 4096 word memory and its registers
+//This class has no dependency on the GUI, so it can be used by the app and the command-line runner alike
+class Computer {
+	public:
+		Computer();
+
+		//Clear the memory and all of the registers
+		void reset();
+
+		//Clear all of the registers but keep the memory
+		void reset_registers();
+
+		//Execute the next instruction, or the interrupt cycle if the R flag is set
+		//FGI, FGO and INPR are inputs, so they should be set before calling this function
+		//The address of the memory word that might be changed and its old value are stored in data_change
+		//Returns true if the computer has halted
+		bool step(std::pair<int, uint16_t> &data_change);
+
+		//Execute at most max_steps instructions (or interrupt cycles) with the fast interpreter, which doesn't report the
+		//changed memory words
+		//halt is set to true if the computer has halted
+		//If stop_after_io is true, the execution also stops after INP and OUT, so the devices can be served before the next
+		//instruction
+		//Returns the number of executed steps
+		uint64_t execute(uint64_t max_steps, bool &halt, bool stop_after_io = false);
+
+		//Execute instructions until the computer halts or one of the limits is reached (a limit of 0 means no limit)
+		//The number of executed instructions is stored in steps
+		//observer(data_change, halt) is called after each instruction, e.g. for storing the history of the execution
+		template <typename Observer>
+		StopReason run(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps, Observer &&observer);
+
+		//Without an observer, the fast interpreter is used
+		StopReason run(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps);
+
+		//Execute instructions like run, but also stop before an instruction at an execute breakpoint (except for the first
+		//instruction, so that a run can continue from a breakpoint), after an instruction that has accessed a watched word
+		//and after a step that has made a condition true
+		//Without any breakpoints, this is run itself, so the breakpoints cost nothing until one is set
+		template <typename Observer>
+		StopReason run_with_breakpoints(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps, const Breakpoints &breakpoints, Observer &&observer);
+		StopReason run_with_breakpoints(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps, const Breakpoints &breakpoints);
+
+		//The address of the watched word that the step which has just been executed has read or written (-1 if none)
+		//interrupt is the R flag before the step, and data_change is what the step has reported
+		int watched_address(bool interrupt, const std::pair<int, uint16_t> &data_change, const Breakpoints &breakpoints) const;
+
+		//The memory of the Basic computer (4096 words of 16 bits)
+		uint16_t memory[4096];
+
+		//The current register values
+		Registers registers;
+};
+
+template <typename Observer>
+StopReason Computer::run(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps, Observer &&observer) {
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(max_milliseconds);
+	std::pair<int, uint16_t> data_change;
+	steps = 0;
+	while (true) {
+		bool halt = step(data_change);
+		steps++;
+		observer(data_change, halt);
+		if (halt)
+			return StopReason::Halt;
+		if (max_steps != 0 && steps >= max_steps)
+			return StopReason::StepLimit;
+		//Reading the clock is slow compared to an instruction, so it is only checked every 1024 instructions
+		if (max_milliseconds != 0 && (steps & 1023) == 0 && std::chrono::steady_clock::now() >= deadline)
+			return StopReason::TimeLimit;
+	}
+}
+
+template <typename Observer>
+StopReason Computer::run_with_breakpoints(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps, const Breakpoints &breakpoints, Observer &&observer) {
+	if (breakpoints.empty())
+		return run(max_steps, max_milliseconds, steps, std::forward<Observer>(observer));
+	bool watch = (breakpoints.count(BREAK_READ) + breakpoints.count(BREAK_WRITE) != 0);
+	bool conditional = !breakpoints.conditions().empty();
+	Registers before;
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(max_milliseconds);
+	std::pair<int, uint16_t> data_change;
+	steps = 0;
+	while (true) {
+		//The interrupt cycle doesn't execute the instruction at the PC
+		bool interrupt = registers.R;
+		if (steps != 0 && !interrupt && breakpoints.has(BREAK_EXECUTE, registers.PC))
+			return StopReason::Breakpoint;
+		if (conditional)
+			before = registers;
+		bool halt = step(data_change);
+		steps++;
+		observer(data_change, halt);
+		if (halt)
+			return StopReason::Halt;
+		if (watch && watched_address(interrupt, data_change, breakpoints) != -1)
+			return StopReason::Breakpoint;
+		if (conditional && breakpoints.true_condition(before, registers, memory) != -1)
+			return StopReason::Breakpoint;
+		if (max_steps != 0 && steps >= max_steps)
+			return StopReason::StepLimit;
+		//Reading the clock is slow compared to an instruction, so it is only checked every 1024 instructions
+		if (max_milliseconds != 0 && (steps & 1023) == 0 && std::chrono::steady_clock::now() >= deadline)
+			return StopReason::TimeLimit;
+	}
+}
@@ -0,0 +1,296 @@
+#include "Condition.h"
+#include "Computer.h"
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+
+//The maximum nesting of parentheses and unary operators in a condition
+#define CONDITION_MAX_NESTING 64
+
+//The operations of the bytecode, each one works on the stack of 16 bit values
+enum ConditionOperation : uint8_t {
+	CONDITION_NUMBER,		//Push the operand
+	CONDITION_WORD,			//Push the 16 bit register at the offset in the operand, after the step
+	CONDITION_BYTE,			//Push the 8 bit register or the flag at the offset in the operand, after the step
+	CONDITION_OLD_WORD,		//The same as CONDITION_WORD, before the step
+	CONDITION_OLD_BYTE,		//The same as CONDITION_BYTE, before the step
+	CONDITION_MEMORY,		//Replace the address on the top with the memory word at it
+	CONDITION_NOT,
+	CONDITION_NEGATE,
+	CONDITION_COMPLEMENT,
+	//The binary operations replace the two values on the top with the result
+	CONDITION_OR,
+	CONDITION_AND,
+	CONDITION_EQUAL,
+	CONDITION_NOT_EQUAL,
+	CONDITION_LESS,
+	CONDITION_LESS_EQUAL,
+	CONDITION_GREATER,
+	CONDITION_GREATER_EQUAL,
+	CONDITION_BIT_OR,
+	CONDITION_BIT_XOR,
+	CONDITION_BIT_AND,
+	CONDITION_ADD,
+	CONDITION_SUBTRACT
+};
+
+//A binary operation with this bit takes its right value from the operand instead of the stack, so comparing with a number
+//is a single instruction
+#define CONDITION_CONSTANT 0x80
+
+//The registers that a condition can use and where they are in the Registers structure
+struct ConditionRegister {
+	const char *name;
+	uint8_t offset;
+	bool word;
+};
+#define CONDITION_REGISTERS 15
+static const ConditionRegister condition_registers[CONDITION_REGISTERS] = {
+	{"IR", offsetof(Registers, IR), true}, {"AC", offsetof(Registers, AC), true}, {"DR", offsetof(Registers, DR), true},
+	{"PC", offsetof(Registers, PC), true}, {"AR", offsetof(Registers, AR), true}, {"MAR", offsetof(Registers, MAR), true},
+	{"TR", offsetof(Registers, TR), true}, {"INPR", offsetof(Registers, INPR), false}, {"OUTR", offsetof(Registers, OUTR), false},
+	{"I", offsetof(Registers, I), false}, {"E", offsetof(Registers, E), false}, {"R", offsetof(Registers, R), false},
+	{"IEN", offsetof(Registers, IEN), false}, {"FGI", offsetof(Registers, FGI), false}, {"FGO", offsetof(Registers, FGO), false}
+};
+
+static int16_t read_word(const Registers &registers, int offset) {
+	uint16_t value;
+	std::memcpy(&value, reinterpret_cast<const uint8_t *>(&registers) + offset, sizeof(value));
+	return int16_t(value);
+}
+
+static int16_t read_byte(const Registers &registers, int offset) {
+	return reinterpret_cast<const uint8_t *>(&registers)[offset];
+}
+
+//The binary operators of each precedence level, from the lowest precedence to the highest
+//A longer operator comes before its prefix, so that "<=" isn't read as "<"
+struct BinaryOperator {
+	const char *text;
+	ConditionOperation operation;
+};
+#define PRECEDENCE_LEVELS 8
+static const BinaryOperator binary_operators[PRECEDENCE_LEVELS][5] = {
+	{{"||", CONDITION_OR}},
+	{{"&&", CONDITION_AND}},
+	{{"==", CONDITION_EQUAL}, {"!=", CONDITION_NOT_EQUAL}},
+	{{"<=", CONDITION_LESS_EQUAL}, {">=", CONDITION_GREATER_EQUAL}, {"<", CONDITION_LESS}, {">", CONDITION_GREATER}},
+	{{"|", CONDITION_BIT_OR}},
+	{{"^", CONDITION_BIT_XOR}},
+	{{"&", CONDITION_BIT_AND}},
+	{{"+", CONDITION_ADD}, {"-", CONDITION_SUBTRACT}}
+};
+
+//A recursive descent parser that emits the bytecode of a condition while it reads it
+class ConditionParser {
+	public:
+		ConditionParser(const std::string &text, std::vector<ConditionInstruction> &code) : text_(text), code_(code), position_(0), depth_(0), nesting_(0) {}
+
+		bool parse(std::string &error_text) {
+			bool valid = parse_binary(0);
+			skip_spaces();
+			if (valid && position_ < text_.size())
+				valid = fail("Unexpected \"" + text_.substr(position_, 1) + "\" in the condition.");
+			if (!valid)
+				error_text = error_text_;
+			return valid;
+		}
+
+	protected:
+		bool fail(const std::string &error_text) {
+			if (error_text_.empty())
+				error_text_ = error_text;
+			return false;
+		}
+
+		void skip_spaces() {
+			while (position_ < text_.size() && isspace((unsigned char)text_[position_]))
+				position_++;
+		}
+
+		//Read the given operator if it is next, "|" and "&" aren't read from "||" and "&&"
+		bool match(const char *op) {
+			skip_spaces();
+			size_t length = strlen(op);
+			if (text_.compare(position_, length, op) != 0)
+				return false;
+			if (length == 1 && (op[0] == '|' || op[0] == '&') && position_ + 1 < text_.size() && text_[position_ + 1] == op[0])
+				return false;
+			position_ += length;
+			return true;
+		}
+
+		//Add an instruction and keep track of the depth of the stack
+		//A binary operation whose right value is a number takes the number as its operand
+		bool emit(ConditionOperation operation, int16_t operand = 0) {
+			if (operation >= CONDITION_OR && !code_.empty() && code_.back().operation == CONDITION_NUMBER) {
+				code_.back().operation = uint8_t(operation | CONDITION_CONSTANT);
+				depth_--;
+				return true;
+			}
+			if (operation <= CONDITION_OLD_BYTE)
+				depth_++;
+			else if (operation >= CONDITION_OR)
+				depth_--;
+			if (depth_ > CONDITION_MAX_DEPTH)
+				return fail("The condition is too complex.");
+			code_.push_back({operation, operand});
+			return true;
+		}
+
+		bool parse_binary(int level) {
+			if (level == PRECEDENCE_LEVELS)
+				return parse_unary();
+			if (!parse_binary(level + 1))
+				return false;
+			while (true) {
+				const BinaryOperator *found = nullptr;
+				for (const BinaryOperator &op : binary_operators[level])
+					if (op.text != nullptr && match(op.text)) {
+						found = &op;
+						break;
+					}
+				if (found == nullptr)
+					return true;
+				if (!parse_binary(level + 1) || !emit(found->operation))
+					return false;
+			}
+		}
+
+		bool parse_unary() {
+			if (++nesting_ > CONDITION_MAX_NESTING)
+				return fail("The condition is too complex.");
+			bool valid;
+			if (match("!"))
+				valid = parse_unary() && emit(CONDITION_NOT);
+			else if (match("-"))
+				valid = parse_unary() && emit(CONDITION_NEGATE);
+			else if (match("~"))
+				valid = parse_unary() && emit(CONDITION_COMPLEMENT);
+			else if (match("("))
+				valid = parse_binary(0) && expect(")");
+			else
+				valid = parse_operand();
+			nesting_--;
+			return valid;
+		}
+
+		bool expect(const char *op) {
+			if (match(op))
+				return true;
+			if (position_ == text_.size())
+				return fail("Unexpected end of the condition.");
+			return fail("Expected \"" + std::string(op) + "\" in the condition.");
+		}
+
+		//A number, a register, old(register) or M[address]
+		bool parse_operand() {
+			skip_spaces();
+			if (position_ == text_.size())
+				return fail("Unexpected end of the condition.");
+			if (isdigit((unsigned char)text_[position_]))
+				return parse_number();
+			std::string name;
+			while (position_ < text_.size() && isalnum((unsigned char)text_[position_]))
+				name += char(toupper((unsigned char)text_[position_++]));
+			if (name.empty())
+				return fail("Unexpected \"" + text_.substr(position_, 1) + "\" in the condition.");
+			if (name == "M" && match("["))
+				return parse_binary(0) && expect("]") && emit(CONDITION_MEMORY);
+			bool old = (name == "OLD" && match("("));
+			if (old) {
+				skip_spaces();
+				name.clear();
+				while (position_ < text_.size() && isalnum((unsigned char)text_[position_]))
+					name += char(toupper((unsigned char)text_[position_++]));
+			}
+			int index = 0;
+			while (index < CONDITION_REGISTERS && name != condition_registers[index].name)
+				index++;
+			if (index == CONDITION_REGISTERS)
+				return fail("Unknown register \"" + name + "\" in the condition.");
+			const ConditionRegister &found = condition_registers[index];
+			if (old)
+				return expect(")") && emit(found.word ? CONDITION_OLD_WORD : CONDITION_OLD_BYTE, found.offset);
+			return emit(found.word ? CONDITION_WORD : CONDITION_BYTE, found.offset);
+		}
+
+		//A decimal number or a 0x hexadecimal number, it must fit in a 16 bit word
+		bool parse_number() {
+			size_t start = position_;
+			int base = 10;
+			if (text_.compare(position_, 2, "0x") == 0 || text_.compare(position_, 2, "0X") == 0) {
+				base = 16;
+				position_ += 2;
+			}
+			long value = 0;
+			size_t digits = 0;
+			while (position_ < text_.size() && isxdigit((unsigned char)text_[position_]) && (base == 16 || isdigit((unsigned char)text_[position_]))) {
+				char c = char(toupper((unsigned char)text_[position_++]));
+				//The value stops growing once it is too large, so that a long number can't overflow it
+				if (value <= 0xFFFF)
+					value = value * base + (isdigit((unsigned char)c) ? c - '0' : c - 'A' + 10);
+				digits++;
+			}
+			if (digits == 0)
+				return fail("Expected a hexadecimal number in the condition.");
+			if (value > 0xFFFF)
+				return fail("The number " + text_.substr(start, position_ - start) + " doesn't fit in a word.");
+			return emit(CONDITION_NUMBER, int16_t(uint16_t(value)));
+		}
+
+		const std::string &text_;
+		std::vector<ConditionInstruction> &code_;
+		std::string error_text_;
+		size_t position_;
+		int depth_, nesting_;
+};
+
+bool Condition::compile(const std::string &text, std::string &error_text) {
+	std::vector<ConditionInstruction> code;
+	ConditionParser parser(text, code);
+	if (!parser.parse(error_text))
+		return false;
+	text_ = text;
+	code_.swap(code);
+	return true;
+}
+
+bool Condition::evaluate(const Registers &before, const Registers &after, const uint16_t *memory) const {
+	int16_t stack[CONDITION_MAX_DEPTH];
+	int top = -1;
+	for (const ConditionInstruction &instruction : code_) {
+		switch (instruction.operation) {
+			case CONDITION_NUMBER: stack[++top] = instruction.operand; break;
+			case CONDITION_WORD: stack[++top] = read_word(after, instruction.operand); break;
+			case CONDITION_BYTE: stack[++top] = read_byte(after, instruction.operand); break;
+			case CONDITION_OLD_WORD: stack[++top] = read_word(before, instruction.operand); break;
+			case CONDITION_OLD_BYTE: stack[++top] = read_byte(before, instruction.operand); break;
+			case CONDITION_MEMORY: stack[top] = int16_t(memory[stack[top] & ((1 << 12) - 1)]); break;
+			case CONDITION_NOT: stack[top] = (stack[top] == 0); break;
+			case CONDITION_NEGATE: stack[top] = int16_t(-stack[top]); break;
+			case CONDITION_COMPLEMENT: stack[top] = int16_t(~stack[top]); break;
+			default: {
+				int16_t right = ((instruction.operation & CONDITION_CONSTANT) ? instruction.operand : stack[top--]);
+				int16_t &left = stack[top];
+				switch (instruction.operation & ~CONDITION_CONSTANT) {
+					case CONDITION_OR: left = (left != 0 || right != 0); break;
+					case CONDITION_AND: left = (left != 0 && right != 0); break;
+					case CONDITION_EQUAL: left = (left == right); break;
+					case CONDITION_NOT_EQUAL: left = (left != right); break;
+					case CONDITION_LESS: left = (left < right); break;
+					case CONDITION_LESS_EQUAL: left = (left <= right); break;
+					case CONDITION_GREATER: left = (left > right); break;
+					case CONDITION_GREATER_EQUAL: left = (left >= right); break;
+					case CONDITION_BIT_OR: left = int16_t(left | right); break;
+					case CONDITION_BIT_XOR: left = int16_t(left ^ right); break;
+					case CONDITION_BIT_AND: left = int16_t(left & right); break;
+					case CONDITION_ADD: left = int16_t(left + right); break;
+					default: left = int16_t(left - right); break;
+				}
+				break;
+			}
+		}
+	}
+	return top == 0 && stack[0] != 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Registers;
+
+//The maximum depth of the stack that a condition uses, a deeper condition isn't compiled
+#define CONDITION_MAX_DEPTH 32
+
+//An instruction of the bytecode of a condition: an operation and its operand (a number or the offset of a register)
+struct ConditionInstruction {
+	uint8_t operation;
+	int16_t operand;
+};
+
+//A condition of a conditional breakpoint, such as "PC == 0x120 && AC < 0" or "E != old(E) && IEN == 1"
+//It is parsed once and compiled to a small stack bytecode, which is evaluated after every step of a run
+//The operands are the registers (IR, AC, DR, PC, AR, MAR, TR, INPR, OUTR and the flags I, E, R, IEN, FGI, FGO), old(register)
+//for the value before the step, M[address] for a memory word, and decimal or 0x hexadecimal numbers
+//The values are 16 bit words compared as signed numbers (like AC for SPA and SNA), the operators are the ones of C, but
+//the bitwise operators bind tighter than the comparisons (so "IR & 0xF000 == 0x7000" needs no parentheses):
+//	|| && == != < <= > >= | ^ & + - and the unary ! - ~
+class Condition {
+	public:
+		//Compile the text of a condition, returns false and sets error_text if it isn't valid
+		bool compile(const std::string &text, std::string &error_text);
+
+		//Check whether the condition holds after a step, before has the registers from before the step
+		bool evaluate(const Registers &before, const Registers &after, const uint16_t *memory) const;
+
+		//The text that the condition has been compiled from
+		const std::string &text() const { return text_; }
+
+	protected:
+		std::string text_;
+		std::vector<ConditionInstruction> code_;
+};
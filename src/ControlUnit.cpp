@@ -0,0 +1,259 @@
+#include "ControlUnit.h"
+#include <cstring>
+
+ControlUnit::ControlUnit(Computer &computer) : computer_(computer) {
+	before_ = computer_.registers;
+	reset();
+	clear_counters();
+}
+
+void ControlUnit::reset() {
+	sc_ = 0;
+	operation_ = OP_NOP;
+	micro_operations_ = "";
+	has_data_change_ = false;
+	instruction_cycles_ = 0;
+}
+
+void ControlUnit::abort() {
+	if (sc_ == 0)
+		return;
+	if (has_data_change_)
+		computer_.memory[data_change_.first] = data_change_.second;
+	computer_.registers = before_;
+	cycles_ -= instruction_cycles_;
+	reset();
+}
+
+bool ControlUnit::tick(bool &halt) {
+	Registers &registers = computer_.registers;
+	uint16_t *memory = computer_.memory;
+	halt = false;
+	bool done = false;
+
+	if (sc_ == 0) {
+		before_ = registers;
+		has_data_change_ = false;
+		instruction_cycles_ = 0;
+		operation_ = (registers.R ? INTERRUPT_CYCLE : OP_NOP);
+	}
+	cycles_++;
+	instruction_cycles_++;
+
+	//The interrupt cycle stores the return address at 0 and continues at 1
+	if (operation_ == INTERRUPT_CYCLE) {
+		switch (sc_) {
+			case 0:
+				registers.AR = 0;
+				registers.TR = registers.PC;
+				micro_operations_ = "RT0: AR <- 0, TR <- PC";
+				break;
+			case 1:
+				data_change_ = std::make_pair(0, memory[0]);
+				has_data_change_ = true;
+				memory[registers.AR] = registers.TR;
+				registers.PC = 0;
+				micro_operations_ = "RT1: M[AR] <- TR, PC <- 0";
+				break;
+			default:
+				registers.PC = registers.PC + 1;
+				registers.IEN = 0;
+				registers.R = 0;
+				micro_operations_ = "RT2: PC <- PC + 1, IEN <- 0, R <- 0, SC <- 0";
+				done = true;
+				break;
+		}
+	}
+	//Fetch and decode
+	else if (sc_ == 0) {
+		registers.AR = (registers.PC & ((1 << 12) - 1));
+		micro_operations_ = "T0: AR <- PC";
+	}
+	else if (sc_ == 1) {
+		registers.IR = memory[registers.AR];
+		registers.PC = registers.PC + 1;
+		micro_operations_ = "T1: IR <- M[AR], PC <- PC + 1";
+	}
+	else if (sc_ == 2) {
+		registers.AR = (registers.IR & ((1 << 12) - 1));
+		registers.I = (registers.IR >> 15);
+		operation_ = decode_table()[registers.IR];
+		//The register-reference and IO instructions don't change the memory
+		if (operation_ >= OP_CLA) {
+			data_change_ = std::make_pair(int(registers.AR), memory[registers.AR]);
+			has_data_change_ = true;
+		}
+		micro_operations_ = "T2: AR <- IR(0-11), I <- IR(15), D0...D7 <- Decode IR(12-14)";
+	}
+	//Register-reference and IO instructions
+	else if (operation_ >= OP_CLA) {
+		switch (operation_) {
+			case OP_CLA: registers.AC = 0; micro_operations_ = "D7I'T3: AC <- 0"; break;
+			case OP_CLE: registers.E = 0; micro_operations_ = "D7I'T3: E <- 0"; break;
+			case OP_CMA: registers.AC = ~registers.AC; micro_operations_ = "D7I'T3: AC <- AC'"; break;
+			case OP_CME: registers.E = !registers.E; micro_operations_ = "D7I'T3: E <- E'"; break;
+			case OP_CIR: {
+				bool tmp = registers.E;
+				registers.E = (registers.AC & 1);
+				registers.AC = ((registers.AC >> 1) | (uint16_t(tmp) << 15));
+				micro_operations_ = "D7I'T3: AC <- shr AC, AC(15) <- E, E <- AC(0)";
+				break;
+			}
+			case OP_CIL:
+				registers.E = ((registers.AC & (1 << 15)) >> 15);
+				registers.AC = ((registers.AC << 1) | uint16_t(registers.E));
+				micro_operations_ = "D7I'T3: AC <- shl AC, AC(0) <- E, E <- AC(15)";
+				break;
+			case OP_INC: registers.AC = registers.AC + 1; micro_operations_ = "D7I'T3: AC <- AC + 1"; break;
+			case OP_SPA: if ((registers.AC & (1 << 15)) == 0) registers.PC = registers.PC + 1; micro_operations_ = "D7I'T3: If (AC(15) = 0) then (PC <- PC + 1)"; break;
+			case OP_SNA: if ((registers.AC & (1 << 15)) != 0) registers.PC = registers.PC + 1; micro_operations_ = "D7I'T3: If (AC(15) = 1) then (PC <- PC + 1)"; break;
+			case OP_SZA: if (registers.AC == 0) registers.PC = registers.PC + 1; micro_operations_ = "D7I'T3: If (AC = 0) then (PC <- PC + 1)"; break;
+			case OP_SZE: if (registers.E == 0) registers.PC = registers.PC + 1; micro_operations_ = "D7I'T3: If (E = 0) then (PC <- PC + 1)"; break;
+			case OP_HLT: halt = true; micro_operations_ = "D7I'T3: S <- 0"; break;
+			case OP_INP: registers.AC = registers.INPR; registers.FGI = 0; micro_operations_ = "D7IT3: AC(0-7) <- INPR, FGI <- 0"; break;
+			case OP_OUT: registers.OUTR = (registers.AC & ((1 << 8) - 1)); registers.FGO = 0; micro_operations_ = "D7IT3: OUTR <- AC(0-7), FGO <- 0"; break;
+			case OP_SKI: if (registers.FGI == 1) registers.PC = registers.PC + 1; micro_operations_ = "D7IT3: If (FGI = 1) then (PC <- PC + 1)"; break;
+			case OP_SKO: if (registers.FGO == 1) registers.PC = registers.PC + 1; micro_operations_ = "D7IT3: If (FGO = 1) then (PC <- PC + 1)"; break;
+			case OP_ION: registers.IEN = 1; micro_operations_ = "D7IT3: IEN <- 1"; break;
+			case OP_IOF: registers.IEN = 0; micro_operations_ = "D7IT3: IEN <- 0"; break;
+			default: micro_operations_ = "D7T3: Nothing (not a valid instruction)"; break;
+		}
+		done = true;
+	}
+	//The effective address of a memory-reference instruction
+	else if (sc_ == 3) {
+		if (operation_ >= OP_AND_I) {
+			registers.AR = (memory[registers.AR] & ((1 << 12) - 1));
+			micro_operations_ = "D7'IT3: AR <- M[AR]";
+		}
+		else
+			micro_operations_ = "D7'I'T3: Nothing";
+		data_change_ = std::make_pair(int(registers.AR), memory[registers.AR]);
+		has_data_change_ = true;
+	}
+	//Memory-reference instructions, the direct and the indirect versions have the same micro-operations from T4
+	else {
+		switch (operation_ % (OP_ISZ + 1) * 8 + sc_) {
+			case OP_AND * 8 + 4: registers.DR = memory[registers.AR]; micro_operations_ = "D0T4: DR <- M[AR]"; break;
+			case OP_AND * 8 + 5: registers.AC = (registers.AC & registers.DR); micro_operations_ = "D0T5: AC <- AC ^ DR, SC <- 0"; done = true; break;
+			case OP_ADD * 8 + 4: registers.DR = memory[registers.AR]; micro_operations_ = "D1T4: DR <- M[AR]"; break;
+			case OP_ADD * 8 + 5:
+				registers.AC = registers.AC + registers.DR;
+				registers.E = ((registers.AC >> 15) & (registers.DR >> 15));
+				micro_operations_ = "D1T5: AC <- AC + DR, E <- Cout, SC <- 0";
+				done = true;
+				break;
+			case OP_LDA * 8 + 4: registers.DR = memory[registers.AR]; micro_operations_ = "D2T4: DR <- M[AR]"; break;
+			case OP_LDA * 8 + 5: registers.AC = registers.DR; micro_operations_ = "D2T5: AC <- DR, SC <- 0"; done = true; break;
+			case OP_STA * 8 + 4: memory[registers.AR] = registers.AC; micro_operations_ = "D3T4: M[AR] <- AC, SC <- 0"; done = true; break;
+			case OP_BUN * 8 + 4: registers.PC = registers.AR; micro_operations_ = "D4T4: PC <- AR, SC <- 0"; done = true; break;
+			case OP_BSA * 8 + 4:
+				memory[registers.AR] = registers.PC;
+				registers.AR = ((registers.AR + 1) & ((1 << 12) - 1));
+				micro_operations_ = "D5T4: M[AR] <- PC, AR <- AR + 1";
+				break;
+			case OP_BSA * 8 + 5: registers.PC = registers.AR; micro_operations_ = "D5T5: PC <- AR, SC <- 0"; done = true; break;
+			case OP_ISZ * 8 + 4: registers.DR = memory[registers.AR]; micro_operations_ = "D6T4: DR <- M[AR]"; break;
+			case OP_ISZ * 8 + 5: registers.DR = registers.DR + 1; micro_operations_ = "D6T5: DR <- DR + 1"; break;
+			case OP_ISZ * 8 + 6:
+				memory[registers.AR] = registers.DR;
+				if (registers.DR == 0)
+					registers.PC = registers.PC + 1;
+				micro_operations_ = "D6T6: M[AR] <- DR, if (DR = 0) then (PC <- PC + 1), SC <- 0";
+				done = true;
+				break;
+		}
+	}
+	//The M[AR] register always shows the word at AR
+	registers.MAR = memory[registers.AR];
+
+	if (done)
+		finish(halt);
+	else
+		sc_++;
+	return done;
+}
+
+void ControlUnit::finish(bool halt) {
+	Registers &registers = computer_.registers;
+	//Check the conditions for the R flag
+	registers.R = registers.IEN & (registers.FGO | registers.FGI);
+	//If the computer has halted, then the PC register shouldn't be incremented
+	if (halt)
+		registers.PC = registers.PC - 1;
+	//The PC register is 12 bits wide, so it must stay inside the memory
+	registers.PC = (registers.PC & ((1 << 12) - 1));
+	sc_ = 0;
+	instructions_++;
+	operation_cycles_[operation_] += instruction_cycles_;
+	operation_counts_[operation_]++;
+}
+
+bool ControlUnit::step(std::pair<int, uint16_t> &data_change) {
+	bool halt;
+	while (!tick(halt))
+		;
+	data_change = data_change_;
+	return halt;
+}
+
+StopReason ControlUnit::run(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps) {
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(max_milliseconds);
+	std::pair<int, uint16_t> data_change;
+	steps = 0;
+	while (true) {
+		bool halt = step(data_change);
+		steps++;
+		if (halt)
+			return StopReason::Halt;
+		if (max_steps != 0 && steps >= max_steps)
+			return StopReason::StepLimit;
+		//Reading the clock is slow compared to an instruction, so it is only checked every 1024 instructions
+		if (max_milliseconds != 0 && (steps & 1023) == 0 && std::chrono::steady_clock::now() >= deadline)
+			return StopReason::TimeLimit;
+	}
+}
+
+int ControlUnit::timing_signal() const {
+	return sc_;
+}
+
+const char *ControlUnit::micro_operations() const {
+	return micro_operations_;
+}
+
+const Registers &ControlUnit::before() const {
+	return before_;
+}
+
+bool ControlUnit::data_change(std::pair<int, uint16_t> &change) const {
+	change = data_change_;
+	return has_data_change_;
+}
+
+int ControlUnit::instruction_cycles() const {
+	return instruction_cycles_;
+}
+
+uint64_t ControlUnit::cycles() const {
+	return cycles_;
+}
+
+uint64_t ControlUnit::instructions() const {
+	return instructions_;
+}
+
+uint64_t ControlUnit::operation_cycles(int operation) const {
+	return operation_cycles_[operation];
+}
+
+uint64_t ControlUnit::operation_count(int operation) const {
+	return operation_counts_[operation];
+}
+
+void ControlUnit::clear_counters() {
+	cycles_ = 0;
+	instructions_ = 0;
+	std::memset(operation_cycles_, 0, sizeof(operation_cycles_));
+	std::memset(operation_counts_, 0, sizeof(operation_counts_));
+}
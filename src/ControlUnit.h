@@ -0,0 +1,87 @@
+#pragma once
+#include "Computer.h"
+#include "Decode.h"
+#include <cstdint>
+#include <utility>
+
+//The index of the interrupt cycle in the counters of a control unit (after the operations of Decode.h)
+#define INTERRUPT_CYCLE (OP_NOP + 1)
+
+//The control unit of the Basic computer, which executes one clock cycle at a time: the sequence counter goes through the
+//timing signals T0-T6, and each of them executes the micro-operations of the current instruction for that timing signal
+//	Fetch and decode:	R'T0: AR <- PC, R'T1: IR <- M[AR], PC <- PC + 1, R'T2: AR <- IR(0-11), I <- IR(15), decode
+//	Interrupt cycle:	RT0: AR <- 0, TR <- PC, RT1: M[AR] <- TR, PC <- 0, RT2: PC <- PC + 1, IEN <- 0, R <- 0
+//	Execute:			T3 for the register-reference and IO instructions and the indirect address, T4-T6 for the rest
+//After the last clock cycle of an instruction, the registers and the memory are the same as after Computer::step
+//The number of clock cycles of each operation is counted, for the cycles per instruction and the runtime at a clock rate
+class ControlUnit {
+	public:
+		explicit ControlUnit(Computer &computer);
+
+		//Clear the sequence counter, so that the next clock cycle starts a new instruction
+		//This must be called when the state of the computer has been changed from outside (e.g. after assembling)
+		void reset();
+
+		//Undo the clock cycles of the current instruction, so that the computer is back at its T0
+		void abort();
+
+		//Execute the micro-operations of the current timing signal and advance the sequence counter
+		//Returns true if this clock cycle has completed an instruction (or the interrupt cycle), halt is set to true if it
+		//was a HLT
+		bool tick(bool &halt);
+
+		//Execute the clock cycles until the current instruction is completed, the same as Computer::step
+		bool step(std::pair<int, uint16_t> &data_change);
+
+		//Execute instructions until the computer halts or one of the limits is reached (a limit of 0 means no limit)
+		//The number of executed instructions is stored in steps
+		StopReason run(uint64_t max_steps, uint64_t max_milliseconds, uint64_t &steps);
+
+		//The timing signal of the next clock cycle (0 at the start of an instruction)
+		int timing_signal() const;
+
+		//The micro-operations of the last clock cycle, e.g. "T1: IR <- M[AR], PC <- PC + 1"
+		const char *micro_operations() const;
+
+		//The registers at T0 of the current (or the last completed) instruction
+		const Registers &before() const;
+
+		//The memory word that the current instruction might change and its old value, the same as Computer::step
+		//Returns false if it isn't known yet
+		bool data_change(std::pair<int, uint16_t> &change) const;
+
+		//The number of clock cycles of the current (or the last completed) instruction
+		int instruction_cycles() const;
+
+		//The total number of clock cycles and completed instructions (including the interrupt cycles)
+		uint64_t cycles() const;
+		uint64_t instructions() const;
+
+		//The clock cycles and the completed instructions of an operation (see Decode.h, or INTERRUPT_CYCLE)
+		uint64_t operation_cycles(int operation) const;
+		uint64_t operation_count(int operation) const;
+
+		//Clear the counters
+		void clear_counters();
+
+	protected:
+		//Finish the instruction: check the conditions for the R flag and clear the sequence counter
+		void finish(bool halt);
+
+		Computer &computer_;
+
+		//The sequence counter, and the decoded operation of the current instruction (INTERRUPT_CYCLE for the interrupt
+		//cycle)
+		int sc_;
+		uint8_t operation_;
+		const char *micro_operations_;
+
+		Registers before_;
+		std::pair<int, uint16_t> data_change_;
+		bool has_data_change_;
+		int instruction_cycles_;
+
+		uint64_t cycles_, instructions_;
+		uint64_t operation_cycles_[INTERRUPT_CYCLE + 1];
+		uint64_t operation_counts_[INTERRUPT_CYCLE + 1];
+};
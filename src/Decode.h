@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+
+//The fast interpreters use threaded dispatch (a jump through a table of label addresses at the end of each handler)
+//when the compiler supports computed goto, and a switch otherwise
+#if defined(__GNUC__) || defined(__clang__)
+	#define THREADED_DISPATCH 1
+#else
+	#define THREADED_DISPATCH 0
+#endif
+
+//The operations that an instruction word can be decoded into
+//The memory-reference instructions have a direct and an indirect version, the words that start with 7 or F but aren't a valid
+//register-reference or IO instruction do nothing
+enum Operation : uint8_t {
+	OP_AND, OP_ADD, OP_LDA, OP_STA, OP_BUN, OP_BSA, OP_ISZ,
+	OP_AND_I, OP_ADD_I, OP_LDA_I, OP_STA_I, OP_BUN_I, OP_BSA_I, OP_ISZ_I,
+	OP_CLA, OP_CLE, OP_CMA, OP_CME, OP_CIR, OP_CIL, OP_INC, OP_SPA, OP_SNA, OP_SZA, OP_SZE, OP_HLT,
+	OP_INP, OP_OUT, OP_SKI, OP_SKO, OP_ION, OP_IOF,
+	OP_NOP
+};
+
+//The operation of each of the 65536 possible instruction words (computed once, on the first call)
+const uint8_t *decode_table();
+
+//The mnemonic of an operation, e.g. "ADD I" ("NOP" for the words that do nothing)
+const char *operation_name(int operation);
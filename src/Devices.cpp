@@ -0,0 +1,94 @@
+#include "Devices.h"
+
+InputDevice::InputDevice() : head_(0), file_(nullptr), count_(0) {}
+
+InputDevice::~InputDevice() {
+	clear();
+}
+
+void InputDevice::push(const uint8_t *bytes, size_t count) {
+	fifo_.insert(fifo_.end(), bytes, bytes + count);
+}
+
+bool InputDevice::open(const std::string &address, std::string &error_text) {
+	if (file_ != nullptr && file_ != stdin)
+		std::fclose(file_);
+	file_ = (address == "-" ? stdin : std::fopen(address.c_str(), "rb"));
+	if (file_ == nullptr) {
+		error_text = "Failed to load the input file.";
+		return false;
+	}
+	return true;
+}
+
+bool InputDevice::next(uint8_t &byte) {
+	if (head_ < fifo_.size()) {
+		byte = fifo_[head_++];
+		//The FIFO is emptied once all of its bytes have been taken, so it doesn't grow forever
+		if (head_ == fifo_.size()) {
+			fifo_.clear();
+			head_ = 0;
+		}
+		count_++;
+		return true;
+	}
+	if (file_ == nullptr)
+		return false;
+	int c = std::fgetc(file_);
+	if (c == EOF)
+		return false;
+	byte = uint8_t(c);
+	count_++;
+	return true;
+}
+
+void InputDevice::clear() {
+	fifo_.clear();
+	head_ = 0;
+	count_ = 0;
+	if (file_ != nullptr && file_ != stdin)
+		std::fclose(file_);
+	file_ = nullptr;
+}
+
+OutputDevice::OutputDevice() : file_(nullptr), count_(0) {}
+
+OutputDevice::~OutputDevice() {
+	std::string error_text;
+	close(error_text);
+}
+
+bool OutputDevice::open(const std::string &address, std::string &error_text) {
+	close(error_text);
+	file_ = (address == "-" ? stdout : std::fopen(address.c_str(), "wb"));
+	if (file_ == nullptr) {
+		error_text = "Failed to create the output file.";
+		return false;
+	}
+	return true;
+}
+
+void OutputDevice::take(std::string &out) {
+	out.append(bytes_.begin(), bytes_.end());
+	bytes_.clear();
+}
+
+bool OutputDevice::close(std::string &error_text) {
+	if (file_ == nullptr)
+		return true;
+	bool failed = (std::ferror(file_) != 0);
+	failed = (file_ == stdout ? std::fflush(file_) != 0 : std::fclose(file_) != 0) || failed;
+	file_ = nullptr;
+	if (failed) {
+		error_text = "Failed to write the output file.";
+		return false;
+	}
+	return true;
+}
+
+void OutputDevice::clear() {
+	std::string error_text;
+	close(error_text);
+	bytes_.clear();
+	count_ = 0;
+}
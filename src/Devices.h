@@ -0,0 +1,116 @@
+#pragma once
+#include "Computer.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//The input device: a FIFO of the bytes that the program reads through INPR
+//The bytes are pushed from a buffer (e.g. the text typed in the GUI), and once they run out, they are read from a file or
+//a pipe one at a time as the program asks for them, so a pipe can be read while it is still being written
+class InputDevice {
+	public:
+		InputDevice();
+		~InputDevice();
+
+		InputDevice(const InputDevice &) = delete;
+		InputDevice &operator=(const InputDevice &) = delete;
+
+		//Add bytes to the end of the FIFO
+		void push(const uint8_t *bytes, size_t count);
+
+		//Read the bytes from a file or a pipe after the FIFO ("-" is the standard input)
+		//Returns false and sets error_text if the file can't be opened
+		bool open(const std::string &address, std::string &error_text);
+
+		//Take the next byte, returns false if none is available
+		//Reading from a pipe waits until the next byte is written
+		bool next(uint8_t &byte);
+
+		//The number of bytes that the program has taken
+		uint64_t count() const { return count_; }
+
+		//Remove the bytes in the FIFO and close the file
+		void clear();
+
+	protected:
+		std::vector<uint8_t> fifo_;
+		size_t head_;
+		std::FILE *file_;
+		uint64_t count_;
+};
+
+//The output device: keeps every byte that the program writes with OUT, or writes it to a file or a pipe
+class OutputDevice {
+	public:
+		OutputDevice();
+		~OutputDevice();
+
+		OutputDevice(const OutputDevice &) = delete;
+		OutputDevice &operator=(const OutputDevice &) = delete;
+
+		//Write the bytes to a file or a pipe instead of keeping them ("-" is the standard output)
+		//Returns false and sets error_text if the file can't be created
+		bool open(const std::string &address, std::string &error_text);
+
+		void write(uint8_t byte) {
+			count_++;
+			if (file_ != nullptr)
+				std::fputc(byte, file_);
+			else
+				bytes_.push_back(byte);
+		}
+
+		//The bytes that have been kept since the last take()
+		const std::vector<uint8_t> &bytes() const { return bytes_; }
+
+		//Move the kept bytes to the end of out
+		void take(std::string &out);
+
+		//The number of bytes that the program has written
+		uint64_t count() const { return count_; }
+
+		//Close the file, returns false and sets error_text if any write has failed
+		bool close(std::string &error_text);
+
+		//Remove the kept bytes and close the file
+		void clear();
+
+	protected:
+		std::vector<uint8_t> bytes_;
+		std::FILE *file_;
+		uint64_t count_;
+};
+
+//The input and output devices of the Basic computer, which drive FGI, INPR and FGO instead of the user
+//The input device gives the next byte whenever FGI is clear, and the output device takes OUTR whenever FGO is clear
+//These are the devices of the GUI, ManoCLI, the batch runs (see run_with_input) and the lanes of the lockstep engines
+struct IODevices {
+	InputDevice input;
+	OutputDevice output;
+
+	//Connect the devices to the computer: the output device is ready, and the first input byte is given
+	void attach(Registers &registers) {
+		registers.FGO = 1;
+		serve(registers);
+	}
+
+	//Serve the devices after a step
+	void serve(Registers &registers) {
+		serve(registers.FGO, registers.OUTR, registers.FGI, registers.INPR);
+	}
+
+	//Serve the devices of a computer that keeps its flags and buffers in other types (e.g. the lanes of a lockstep engine)
+	template <typename Flag, typename Buffer>
+	void serve(Flag &fgo, Buffer outr, Flag &fgi, Buffer &inpr) {
+		if (!fgo) {
+			output.write(uint8_t(outr));
+			fgo = 1;
+		}
+		uint8_t byte;
+		if (!fgi && input.next(byte)) {
+			inpr = byte;
+			fgi = 1;
+		}
+	}
+};
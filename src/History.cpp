@@ -0,0 +1,314 @@
+#include "History.h"
+#include <algorithm>
+#include <cstring>
+
+//The 8-16 bit registers, in the order that their old values are stored in a record
+#define WIDE_REGISTERS 9
+
+//The bits of a record header
+#define HEADER_WIDE_MASK ((1 << WIDE_REGISTERS) - 1)
+#define HEADER_FLAGS_SHIFT WIDE_REGISTERS
+#define HEADER_MEMORY_CHANGED (1 << 15)
+
+//Get the value of a 8-16 bit register by its index
+static uint16_t get_wide(const Registers &registers, int index) {
+	switch (index) {
+		case 0: return registers.IR;
+		case 1: return registers.AC;
+		case 2: return registers.DR;
+		case 3: return registers.PC;
+		case 4: return registers.AR;
+		case 5: return registers.MAR;
+		case 6: return registers.TR;
+		case 7: return registers.INPR;
+		default: return registers.OUTR;
+	}
+}
+
+//Set the value of a 8-16 bit register by its index
+static void set_wide(Registers &registers, int index, uint16_t value) {
+	switch (index) {
+		case 0: registers.IR = value; break;
+		case 1: registers.AC = value; break;
+		case 2: registers.DR = value; break;
+		case 3: registers.PC = value; break;
+		case 4: registers.AR = value; break;
+		case 5: registers.MAR = value; break;
+		case 6: registers.TR = value; break;
+		case 7: registers.INPR = uint8_t(value); break;
+		default: registers.OUTR = uint8_t(value); break;
+	}
+}
+
+//Pack the 1 bit registers into 6 bits
+static uint16_t get_flags(const Registers &registers) {
+	return uint16_t(registers.I | (registers.E << 1) | (registers.R << 2) | (registers.IEN << 3) | (registers.FGI << 4) | (registers.FGO << 5));
+}
+
+//Unpack the 1 bit registers from 6 bits
+static void set_flags(Registers &registers, uint16_t flags) {
+	registers.I = (flags & 1);
+	registers.E = ((flags >> 1) & 1);
+	registers.R = ((flags >> 2) & 1);
+	registers.IEN = ((flags >> 3) & 1);
+	registers.FGI = ((flags >> 4) & 1);
+	registers.FGO = ((flags >> 5) & 1);
+}
+
+//The number of words in a record with the given header
+static size_t record_size(uint16_t header) {
+	size_t size = 2;
+	for (int i = 0; i < WIDE_REGISTERS; i++)
+		if (header & (1 << i))
+			size++;
+	if (header & HEADER_MEMORY_CHANGED)
+		size += 2;
+	return size;
+}
+
+//Pack the inputs of a step (FGI, FGO and INPR) into 10 bits
+static uint16_t get_inputs(const Registers &registers) {
+	return uint16_t(registers.FGI | (registers.FGO << 1) | (registers.INPR << 2));
+}
+
+//Unpack the inputs of a step
+static void set_inputs(Registers &registers, uint16_t inputs) {
+	registers.FGI = (inputs & 1);
+	registers.FGO = ((inputs >> 1) & 1);
+	registers.INPR = uint8_t(inputs >> 2);
+}
+
+History::History(size_t max_bytes, uint64_t checkpoint_interval) {
+	//The ring buffer must at least fit the largest record
+	size_t words = max_bytes / 2 / sizeof(uint16_t);
+	if (words < 2 + WIDE_REGISTERS + 2)
+		words = 2 + WIDE_REGISTERS + 2;
+	buffer_.resize(words);
+	timeline_limit_ = max_bytes / 2;
+	interval_ = (checkpoint_interval == 0 ? 1 : checkpoint_interval);
+	Computer empty;
+	start(empty);
+}
+
+void History::start(const Computer &computer) {
+	clear_records();
+	checkpoints_.clear();
+	inputs_.clear();
+	inputs_first_ = 0;
+	position_ = 0;
+	add_checkpoint(computer.registers, computer.memory);
+}
+
+void History::clear_records() {
+	head_ = 0;
+	used_ = 0;
+	count_ = 0;
+}
+
+void History::put(uint16_t word) {
+	buffer_[(head_ + used_) % buffer_.size()] = word;
+	used_++;
+}
+
+uint16_t History::from_back(size_t distance) const {
+	return buffer_[(head_ + used_ - distance) % buffer_.size()];
+}
+
+void History::drop_front() {
+	size_t size = record_size(buffer_[head_]);
+	head_ = (head_ + size) % buffer_.size();
+	used_ -= size;
+	count_--;
+}
+
+void History::push_record(const Registers &before, const Registers &after, const std::pair<int, uint16_t> &data_change, const uint16_t memory[4096]) {
+	uint16_t header = uint16_t(get_flags(before) << HEADER_FLAGS_SHIFT);
+	for (int i = 0; i < WIDE_REGISTERS; i++)
+		if (get_wide(before, i) != get_wide(after, i))
+			header |= (1 << i);
+	if (memory[data_change.first] != data_change.second)
+		header |= HEADER_MEMORY_CHANGED;
+
+	//Drop the oldest records until the new record fits
+	size_t size = record_size(header);
+	while (used_ + size > buffer_.size())
+		drop_front();
+
+	put(header);
+	for (int i = 0; i < WIDE_REGISTERS; i++)
+		if (header & (1 << i))
+			put(get_wide(before, i));
+	if (header & HEADER_MEMORY_CHANGED) {
+		put(uint16_t(data_change.first));
+		put(data_change.second);
+	}
+	put(header);
+	count_++;
+	position_++;
+}
+
+int History::pop_record(Registers &registers, uint16_t memory[4096]) {
+	uint16_t header = from_back(1);
+	size_t size = record_size(header);
+	//Read the record from its beginning
+	size_t position = size - 1;
+	for (int i = 0; i < WIDE_REGISTERS; i++)
+		if (header & (1 << i))
+			set_wide(registers, i, from_back(position--));
+	set_flags(registers, header >> HEADER_FLAGS_SHIFT);
+	int restored_address = -1;
+	if (header & HEADER_MEMORY_CHANGED) {
+		restored_address = from_back(position--);
+		memory[restored_address] = from_back(position--);
+	}
+	used_ -= size;
+	count_--;
+	position_--;
+	restore_inputs(registers, position_);
+	return restored_address;
+}
+
+void History::add_checkpoint(const Registers &registers, const uint16_t memory[4096]) {
+	checkpoints_.push_back(Checkpoint());
+	Checkpoint &checkpoint = checkpoints_.back();
+	checkpoint.step = position_;
+	checkpoint.registers = registers;
+	std::memcpy(checkpoint.memory, memory, sizeof(checkpoint.memory));
+
+	//Drop the oldest checkpoints until the size limit is met
+	while (checkpoints_.size() > 1 && memory_usage() - buffer_.size() * sizeof(uint16_t) > timeline_limit_)
+		checkpoints_.pop_front();
+	//Drop the inputs that are needed neither by a checkpoint nor by a record
+	uint64_t needed = std::min(checkpoints_.front().step, position_ - count_);
+	while (inputs_first_ < needed && !inputs_.empty()) {
+		inputs_.pop_front();
+		inputs_first_++;
+	}
+}
+
+void History::truncate_future() {
+	while (!checkpoints_.empty() && checkpoints_.back().step > position_)
+		checkpoints_.pop_back();
+	if (inputs_first_ > position_) {
+		inputs_.clear();
+		inputs_first_ = position_;
+	}
+	else
+		inputs_.resize(size_t(position_ - inputs_first_));
+}
+
+void History::push(const Registers &before, const Registers &after, const std::pair<int, uint16_t> &data_change, const uint16_t memory[4096]) {
+	//If the history has been moved back, the new step replaces the recorded future
+	if (position_ < end() || inputs_first_ > position_)
+		truncate_future();
+	//If no checkpoint is left (the history was moved back before the oldest one), the state before this step becomes one
+	if (checkpoints_.empty()) {
+		std::vector<uint16_t> old_memory(memory, memory + 4096);
+		old_memory[data_change.first] = data_change.second;
+		add_checkpoint(before, old_memory.data());
+	}
+	inputs_.push_back(get_inputs(before));
+	push_record(before, after, data_change, memory);
+	if (position_ % interval_ == 0)
+		add_checkpoint(after, memory);
+}
+
+void History::replay(Computer &computer, uint64_t step) {
+	std::pair<int, uint16_t> data_change;
+	while (position_ < step) {
+		restore_inputs(computer.registers, position_);
+		Registers before = computer.registers;
+		computer.step(data_change);
+		push_record(before, computer.registers, data_change, computer.memory);
+	}
+	//The state of a step is the one that the step was executed from, so it has the inputs that were given before it
+	restore_inputs(computer.registers, position_);
+}
+
+void History::restore_inputs(Registers &registers, uint64_t step) const {
+	if (step >= inputs_first_ && step - inputs_first_ < inputs_.size())
+		set_inputs(registers, inputs_[size_t(step - inputs_first_)]);
+}
+
+bool History::pop(Computer &computer, std::vector<int> &changed_rows) {
+	changed_rows.clear();
+	if (count_ > 0) {
+		int restored_address = pop_record(computer.registers, computer.memory);
+		if (restored_address != -1)
+			changed_rows.push_back(restored_address);
+		return true;
+	}
+	if (position_ > first())
+		return seek(computer, position_ - 1, changed_rows);
+	return false;
+}
+
+bool History::seek(Computer &computer, uint64_t step, std::vector<int> &changed_rows) {
+	changed_rows.clear();
+	if (step < first() || step > end())
+		return false;
+	std::vector<uint16_t> old_memory(computer.memory, computer.memory + 4096);
+
+	//Going back a few steps: undo the records
+	if (step <= position_ && position_ - step <= count_ && position_ - step <= interval_) {
+		while (position_ > step)
+			pop_record(computer.registers, computer.memory);
+	}
+	else {
+		//Find the last checkpoint before the step
+		size_t index = checkpoints_.size();
+		while (index > 0 && checkpoints_[index - 1].step > step)
+			index--;
+		//Going forward: if no checkpoint is closer than the current step, execute forward from here
+		if (step >= position_ && position_ >= inputs_first_ && (index == 0 || checkpoints_[index - 1].step <= position_))
+			replay(computer, step);
+		//Otherwise restore the checkpoint and execute forward from it
+		else if (index > 0) {
+			const Checkpoint &checkpoint = checkpoints_[index - 1];
+			computer.registers = checkpoint.registers;
+			std::memcpy(computer.memory, checkpoint.memory, sizeof(checkpoint.memory));
+			clear_records();
+			position_ = checkpoint.step;
+			replay(computer, step);
+		}
+		//The step can only be reached by undoing the records
+		else {
+			while (position_ > step)
+				pop_record(computer.registers, computer.memory);
+		}
+	}
+
+	for (int i = 0; i < 4096; i++)
+		if (old_memory[i] != computer.memory[i])
+			changed_rows.push_back(i);
+	return true;
+}
+
+Registers History::previous(const Registers &current) const {
+	Registers registers = current;
+	if (count_ == 0)
+		return registers;
+	uint16_t header = from_back(1);
+	size_t position = record_size(header) - 1;
+	for (int i = 0; i < WIDE_REGISTERS; i++)
+		if (header & (1 << i))
+			set_wide(registers, i, from_back(position--));
+	set_flags(registers, header >> HEADER_FLAGS_SHIFT);
+	restore_inputs(registers, position_ - 1);
+	return registers;
+}
+
+bool History::last_changed_pc() const {
+	return count_ > 0 && (from_back(1) & (1 << 3));
+}
+
+uint64_t History::first() const {
+	uint64_t first = position_ - count_;
+	if (!checkpoints_.empty() && checkpoints_.front().step < first)
+		first = checkpoints_.front().step;
+	return first;
+}
+
+size_t History::memory_usage() const {
+	return buffer_.size() * sizeof(uint16_t) + checkpoints_.size() * sizeof(Checkpoint) + inputs_.size() * sizeof(uint16_t);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "Computer.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+//The history of an execution, used for going back to the previous state and for seeking to any executed step
+//Each step is stored as a packed delta record in a ring buffer of 16 bit words:
+//	[header] [old values of the changed 8-16 bit registers] [address, old word (only if the memory changed)] [header]
+//The header holds a bit for each changed register, the old values of the 1 bit registers, and whether the memory changed
+//It is stored at both ends of the record, so that records can be removed from the front (oldest) and the back (newest)
+//Besides the records, a full snapshot of the computer (a checkpoint) is kept every checkpoint_interval steps, along with
+//the inputs (FGI, FGO, INPR) of every step, so any step can be reached by restoring a checkpoint and executing forward
+//When the size limit is reached, the oldest records, checkpoints and inputs are dropped
+class History {
+	public:
+		//max_bytes limits the memory used by the history, half of it is used by the records and half by the checkpoints
+		explicit History(size_t max_bytes = 64 * 1024 * 1024, uint64_t checkpoint_interval = 1024);
+
+		//Remove everything and start a new history from the given state of the computer (step 0)
+		void start(const Computer &computer);
+
+		//Record a step, given the register values before it, the register values and the memory after it, and the memory
+		//word that it might have changed
+		//If the history has been moved back (with pop or seek), the recorded steps after the current one are discarded
+		void push(const Registers &before, const Registers &after, const std::pair<int, uint16_t> &data_change, const uint16_t memory[4096]);
+
+		//Undo the last step, the addresses of the memory words that were restored are stored in changed_rows
+		//Returns false if no previous step exists
+		bool pop(Computer &computer, std::vector<int> &changed_rows);
+
+		//Move the computer to the given step (between first() and end()), the addresses of the changed memory words are stored
+		//in changed_rows
+		//At most checkpoint_interval steps are executed or undone
+		//Returns false if the step is out of range
+		bool seek(Computer &computer, uint64_t step, std::vector<int> &changed_rows);
+
+		//The register values before the current step (the current values if they're unknown)
+		Registers previous(const Registers &current) const;
+
+		//Check whether the last step changed the PC register
+		bool last_changed_pc() const;
+
+		//The current step
+		uint64_t position() const { return position_; }
+
+		//The first step that can be reached
+		uint64_t first() const;
+
+		//The last recorded step (larger than the current step if the history has been moved back)
+		uint64_t end() const { return inputs_first_ + inputs_.size(); }
+
+		//The number of bytes used by the history
+		size_t memory_usage() const;
+
+	protected:
+		//A full snapshot of the computer
+		struct Checkpoint {
+			uint64_t step;
+			Registers registers;
+			uint16_t memory[4096];
+		};
+
+		//Add a record of a step to the ring buffer
+		void push_record(const Registers &before, const Registers &after, const std::pair<int, uint16_t> &data_change, const uint16_t memory[4096]);
+
+		//Undo the last record, returns the address of the restored memory word (-1 if the memory didn't change)
+		int pop_record(Registers &registers, uint16_t memory[4096]);
+
+		//Remove all of the records
+		void clear_records();
+
+		//Execute the recorded steps from the current step until the given step
+		void replay(Computer &computer, uint64_t step);
+
+		//Set FGI, FGO and INPR to the recorded inputs of the given step, if the step has been recorded
+		//The inputs might have been changed between two steps (by the user or an input device), so they're only known here
+		void restore_inputs(Registers &registers, uint64_t step) const;
+
+		//Add a checkpoint of the given state at the current step
+		void add_checkpoint(const Registers &registers, const uint16_t memory[4096]);
+
+		//Discard the recorded inputs and checkpoints after the current step
+		void truncate_future();
+
+		//Add a word to the back of the ring buffer
+		void put(uint16_t word);
+
+		//The word at the given distance from the back of the ring buffer (1 is the last word)
+		uint16_t from_back(size_t distance) const;
+
+		//Remove the oldest record
+		void drop_front();
+
+		std::vector<uint16_t> buffer_;
+		size_t head_, used_, count_;
+
+		std::deque<Checkpoint> checkpoints_;
+		std::deque<uint16_t> inputs_;
+		uint64_t inputs_first_, position_, interval_;
+		size_t timeline_limit_;
+};
@@ -0,0 +1,203 @@
+#include "Image.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+#if defined(_WIN32) || defined(_WIN64)
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+//The sizes of the parts of an image
+#define IMAGE_HEADER_SIZE 16
+#define IMAGE_REGISTERS_SIZE 24
+#define IMAGE_FIXED_SIZE (IMAGE_HEADER_SIZE + IMAGE_REGISTERS_SIZE + 4096 * 2 + 4096 * 4)
+#define IMAGE_SYMBOL_SIZE 8
+
+//A read-only memory mapping of a whole file
+class MappedFile {
+	public:
+		explicit MappedFile(const std::string &address) : data_(nullptr), size_(0) {
+#if defined(_WIN32) || defined(_WIN64)
+			file_ = CreateFileA(address.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			mapping_ = nullptr;
+			LARGE_INTEGER size;
+			if (file_ == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+				return;
+			mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping_ == nullptr)
+				return;
+			data_ = static_cast<const uint8_t *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+			if (data_ != nullptr)
+				size_ = size_t(size.QuadPart);
+#else
+			file_ = open(address.c_str(), O_RDONLY);
+			struct stat info;
+			if (file_ < 0 || fstat(file_, &info) != 0 || info.st_size == 0)
+				return;
+			void *data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, file_, 0);
+			if (data == MAP_FAILED)
+				return;
+			data_ = static_cast<const uint8_t *>(data);
+			size_ = size_t(info.st_size);
+#endif
+		}
+
+		~MappedFile() {
+#if defined(_WIN32) || defined(_WIN64)
+			if (data_ != nullptr)
+				UnmapViewOfFile(data_);
+			if (mapping_ != nullptr)
+				CloseHandle(mapping_);
+			if (file_ != INVALID_HANDLE_VALUE)
+				CloseHandle(file_);
+#else
+			if (data_ != nullptr)
+				munmap(const_cast<uint8_t *>(data_), size_);
+			if (file_ >= 0)
+				close(file_);
+#endif
+		}
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+
+		//The contents of the file (nullptr if it couldn't be mapped)
+		const uint8_t *data() const { return data_; }
+		size_t size() const { return size_; }
+
+	protected:
+		const uint8_t *data_;
+		size_t size_;
+#if defined(_WIN32) || defined(_WIN64)
+		HANDLE file_, mapping_;
+#else
+		int file_;
+#endif
+};
+
+//Read and write little endian values, one byte at a time so that the host's byte order and alignment don't matter
+static uint16_t read_16(const uint8_t *p) {
+	return uint16_t(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_32(const uint8_t *p) {
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static void write_16(std::vector<uint8_t> &out, uint16_t value) {
+	out.push_back(uint8_t(value));
+	out.push_back(uint8_t(value >> 8));
+}
+
+static void write_32(std::vector<uint8_t> &out, uint32_t value) {
+	write_16(out, uint16_t(value));
+	write_16(out, uint16_t(value >> 16));
+}
+
+bool is_image_address(const std::string &address) {
+	return address.size() > 5 && address.compare(address.size() - 5, 5, ".mano") == 0;
+}
+
+bool save_image(const std::string &address, const Computer &computer, const SymbolTable &symbols, const int *source_map, std::string &error_text) {
+	const Registers &registers = computer.registers;
+	std::vector<uint8_t> image;
+	image.reserve(IMAGE_FIXED_SIZE + symbols.size() * IMAGE_SYMBOL_SIZE);
+
+	image.insert(image.end(), {'M', 'A', 'N', 'O'});
+	write_32(image, IMAGE_VERSION);
+	write_32(image, uint32_t(symbols.size()));
+	write_32(image, 0);
+
+	const uint16_t words[7] = {registers.IR, registers.AC, registers.DR, registers.PC, registers.AR, registers.MAR, registers.TR};
+	for (uint16_t word : words)
+		write_16(image, word);
+	image.insert(image.end(), {uint8_t(registers.I), uint8_t(registers.E), uint8_t(registers.R), uint8_t(registers.IEN),
+		uint8_t(registers.FGI), uint8_t(registers.FGO), registers.INPR, registers.OUTR, 0, 0});
+
+	for (int i = 0; i < 4096; i++)
+		write_16(image, computer.memory[i]);
+	for (int i = 0; i < 4096; i++)
+		write_32(image, uint32_t(source_map == nullptr ? -1 : source_map[i]));
+	symbols.for_each([&](uint32_t key, int address) {
+		write_32(image, key);
+		write_32(image, uint32_t(address));
+	});
+
+	std::ofstream file(address, std::ios::binary);
+	file.write(reinterpret_cast<const char *>(image.data()), std::streamsize(image.size()));
+	if (!file) {
+		error_text = "Failed to save file.";
+		return false;
+	}
+	return true;
+}
+
+bool load_image(const std::string &address, Computer &computer, SymbolTable &symbols, int *source_map, std::string &error_text) {
+	MappedFile file(address);
+	if (file.data() == nullptr) {
+		error_text = "Failed to load file.";
+		return false;
+	}
+	const uint8_t *data = file.data();
+	if (file.size() < IMAGE_FIXED_SIZE || std::memcmp(data, "MANO", 4) != 0) {
+		error_text = "The file isn't a memory image.";
+		return false;
+	}
+	if (read_32(data + 4) != IMAGE_VERSION) {
+		error_text = "The memory image has an unsupported version.";
+		return false;
+	}
+	uint32_t symbol_count = read_32(data + 8);
+	if (file.size() != IMAGE_FIXED_SIZE + uint64_t(symbol_count) * IMAGE_SYMBOL_SIZE) {
+		error_text = "The memory image is damaged.";
+		return false;
+	}
+
+	//Check everything before anything is changed
+	const uint8_t *p = data + IMAGE_HEADER_SIZE;
+	Registers registers;
+	registers.IR = read_16(p);
+	registers.AC = read_16(p + 2);
+	registers.DR = read_16(p + 4);
+	registers.PC = read_16(p + 6);
+	registers.AR = read_16(p + 8);
+	registers.MAR = read_16(p + 10);
+	registers.TR = read_16(p + 12);
+	bool *flags[6] = {&registers.I, &registers.E, &registers.R, &registers.IEN, &registers.FGI, &registers.FGO};
+	bool valid = (registers.PC < 4096 && registers.AR < 4096);
+	for (int i = 0; i < 6; i++) {
+		valid = valid && p[14 + i] <= 1;
+		*flags[i] = (p[14 + i] != 0);
+	}
+	registers.INPR = p[20];
+	registers.OUTR = p[21];
+
+	const uint8_t *memory = p + IMAGE_REGISTERS_SIZE;
+	const uint8_t *lines = memory + 4096 * 2;
+	for (int i = 0; i < 4096; i++)
+		valid = valid && int32_t(read_32(lines + 4 * i)) >= -1;
+	const uint8_t *entries = lines + 4096 * 4;
+	for (uint32_t i = 0; i < symbol_count; i++) {
+		uint32_t key = read_32(entries + IMAGE_SYMBOL_SIZE * i), symbol_address = read_32(entries + IMAGE_SYMBOL_SIZE * i + 4);
+		valid = valid && key != 0 && symbol_address < 4096;
+	}
+	if (!valid) {
+		error_text = "The memory image is damaged.";
+		return false;
+	}
+
+	computer.registers = registers;
+	for (int i = 0; i < 4096; i++)
+		computer.memory[i] = read_16(memory + 2 * i);
+	if (source_map != nullptr)
+		for (int i = 0; i < 4096; i++)
+			source_map[i] = int(int32_t(read_32(lines + 4 * i)));
+	symbols.clear();
+	for (uint32_t i = 0; i < symbol_count; i++)
+		symbols.insert(read_32(entries + IMAGE_SYMBOL_SIZE * i), int(read_32(entries + IMAGE_SYMBOL_SIZE * i + 4)));
+	return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "Assembler.h"
+#include "Computer.h"
+#include <string>
+
+//The version of the memory image format, an image with another version isn't loaded
+#define IMAGE_VERSION 1
+
+//A memory image (a .mano file) holds an assembled program: the registers, the 4096 memory words, the source map and the
+//symbol table, so a known-good program can be loaded without parsing and assembling its source
+//The file is little endian and has a fixed layout, so it is read straight from a memory mapping:
+//	"MANO", version (32 bits), the number of symbols (32 bits), 4 reserved bytes
+//	IR, AC, DR, PC, AR, MAR, TR (16 bits each), I, E, R, IEN, FGI, FGO, INPR, OUTR (8 bits each), 2 reserved bytes
+//	the memory (4096 words of 16 bits), the source map (4096 lines of 32 bits, -1 for no line)
+//	the symbols (a packed label and its address, 32 bits each)
+
+//Check whether the given file address has the extension of a memory image (.mano)
+bool is_image_address(const std::string &address);
+
+//Save the state of the computer, its symbol table and its source map (nullptr if it isn't known) as a memory image
+//Returns false and sets error_text if the file can't be written
+bool save_image(const std::string &address, const Computer &computer, const SymbolTable &symbols, const int *source_map, std::string &error_text);
+
+//Load a memory image into the computer, the symbol table and the source map (which may be nullptr)
+//Returns false and sets error_text if the file can't be read or isn't a valid image, nothing is changed in that case
+bool load_image(const std::string &address, Computer &computer, SymbolTable &symbols, int *source_map, std::string &error_text);
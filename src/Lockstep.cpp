@@ -0,0 +1,350 @@
+#include "Lockstep.h"
+#include "Decode.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <memory>
+
+//Loop over all of the lanes, the bodies of these loops only use selects instead of branches, so they are vectorized
+#define FOR_LANES(k) for (int k = 0; k < LOCKSTEP_LANES; k++)
+
+//Choose a for the lanes in the mask and b for the others
+static inline uint16_t select(uint16_t mask, unsigned a, unsigned b) {
+	return uint16_t((a & mask) | (b & ~unsigned(mask)));
+}
+
+//Expand a condition to a lane mask
+static inline uint16_t to_mask(bool condition) {
+	return uint16_t(0) - uint16_t(condition);
+}
+
+LockstepEngine::LockstepEngine(const uint16_t memory[4096]) {
+	for (int address = 0; address < 4096; address++)
+		FOR_LANES(k)
+			memory_[address][k] = memory[address];
+	FOR_LANES(k) {
+		ir_[k] = ac_[k] = dr_[k] = pc_[k] = ar_[k] = mar_[k] = tr_[k] = 0;
+		i_[k] = e_[k] = r_[k] = ien_[k] = fgi_[k] = fgo_[k] = 0;
+		inpr_[k] = outr_[k] = 0;
+		running_[k] = 0;
+		used_[k] = halted_[k] = false;
+		steps_[k] = 0;
+	}
+}
+
+void LockstepEngine::set_input(size_t lane, const std::vector<uint8_t> *input) {
+	devices_[lane].input.push(input->data(), input->size());
+	used_[lane] = true;
+	running_[lane] = 0xFFFF;
+	//The output device is ready from the start
+	fgo_[lane] = 1;
+	serve_devices(lane);
+}
+
+void LockstepEngine::serve_devices(size_t lane) {
+	devices_[lane].serve(fgo_[lane], outr_[lane], fgi_[lane], inpr_[lane]);
+}
+
+void LockstepEngine::interrupt(const uint16_t mask[LOCKSTEP_LANES]) {
+	FOR_LANES(k) {
+		ar_[k] = select(mask[k], 0, ar_[k]);
+		tr_[k] = select(mask[k], pc_[k], tr_[k]);
+		memory_[0][k] = select(mask[k], pc_[k], memory_[0][k]);
+		mar_[k] = select(mask[k], pc_[k], mar_[k]);
+		pc_[k] = select(mask[k], 1, pc_[k]);
+		ien_[k] = select(mask[k], 0, ien_[k]);
+		r_[k] = select(mask[k], 0, r_[k]);
+	}
+}
+
+bool LockstepEngine::execute_group(uint16_t address, uint16_t word, const uint16_t mask[LOCKSTEP_LANES]) {
+	uint8_t operation = decode_table()[word];
+	uint16_t effective_address = (word & ((1 << 12) - 1));
+	const uint16_t *m = mask;
+
+	//Fetch, all of the lanes of the group have the same PC and instruction word
+	FOR_LANES(k) {
+		ir_[k] = select(m[k], word, ir_[k]);
+		pc_[k] = select(m[k], address + 1, pc_[k]);
+		ar_[k] = select(m[k], effective_address, ar_[k]);
+		mar_[k] = select(m[k], memory_[effective_address][k], mar_[k]);
+		i_[k] = select(m[k], word >> 15, i_[k]);
+	}
+
+	//Memory-reference instructions with indirect addressing load the effective address first, which may be different
+	//for each lane
+	bool indirect = (OP_AND_I <= operation && operation <= OP_ISZ_I);
+	if (indirect) {
+		operation = uint8_t(operation - (OP_AND_I - OP_AND));
+		FOR_LANES(k) {
+			if (m[k]) {
+				ar_[k] = (mar_[k] & ((1 << 12) - 1));
+				if (operation != OP_STA && operation != OP_BSA)
+					mar_[k] = memory_[ar_[k]][k];
+			}
+		}
+	}
+
+	switch (operation) {
+		case OP_AND:
+			FOR_LANES(k) {
+				dr_[k] = select(m[k], mar_[k], dr_[k]);
+				ac_[k] = select(m[k], ac_[k] & mar_[k], ac_[k]);
+			}
+			break;
+		case OP_ADD:
+			FOR_LANES(k) {
+				uint16_t sum = uint16_t(ac_[k] + mar_[k]);
+				dr_[k] = select(m[k], mar_[k], dr_[k]);
+				e_[k] = select(m[k], (sum >> 15) & (mar_[k] >> 15), e_[k]);
+				ac_[k] = select(m[k], sum, ac_[k]);
+			}
+			break;
+		case OP_LDA:
+			FOR_LANES(k) {
+				dr_[k] = select(m[k], mar_[k], dr_[k]);
+				ac_[k] = select(m[k], mar_[k], ac_[k]);
+			}
+			break;
+		case OP_STA:
+			if (indirect) {
+				FOR_LANES(k)
+					if (m[k])
+						memory_[ar_[k]][k] = ac_[k];
+			}
+			else {
+				FOR_LANES(k)
+					memory_[effective_address][k] = select(m[k], ac_[k], memory_[effective_address][k]);
+			}
+			FOR_LANES(k)
+				mar_[k] = select(m[k], ac_[k], mar_[k]);
+			break;
+		case OP_BUN:
+			FOR_LANES(k)
+				pc_[k] = select(m[k], ar_[k], pc_[k]);
+			break;
+		case OP_BSA:
+			//The return address is stored before the PC is kept inside of the memory, the same as Computer::step
+			FOR_LANES(k) {
+				if (m[k]) {
+					memory_[ar_[k]][k] = pc_[k];
+					ar_[k] = ((ar_[k] + 1) & ((1 << 12) - 1));
+					mar_[k] = memory_[ar_[k]][k];
+					pc_[k] = ar_[k];
+				}
+			}
+			break;
+		case OP_ISZ:
+			FOR_LANES(k) {
+				if (m[k]) {
+					dr_[k] = uint16_t(mar_[k] + 1);
+					memory_[ar_[k]][k] = dr_[k];
+					mar_[k] = dr_[k];
+					if (dr_[k] == 0)
+						pc_[k]++;
+				}
+			}
+			break;
+
+		//Register-reference instructions
+		case OP_CLA:
+			FOR_LANES(k)
+				ac_[k] = select(m[k], 0, ac_[k]);
+			break;
+		case OP_CLE:
+			FOR_LANES(k)
+				e_[k] = select(m[k], 0, e_[k]);
+			break;
+		case OP_CMA:
+			FOR_LANES(k)
+				ac_[k] = select(m[k], ~unsigned(ac_[k]), ac_[k]);
+			break;
+		case OP_CME:
+			FOR_LANES(k)
+				e_[k] = select(m[k], e_[k] ^ 1, e_[k]);
+			break;
+		case OP_CIR:
+			FOR_LANES(k) {
+				uint16_t rotated = uint16_t((ac_[k] >> 1) | (e_[k] << 15));
+				e_[k] = select(m[k], ac_[k] & 1, e_[k]);
+				ac_[k] = select(m[k], rotated, ac_[k]);
+			}
+			break;
+		case OP_CIL:
+			FOR_LANES(k) {
+				uint16_t high = uint16_t(ac_[k] >> 15);
+				ac_[k] = select(m[k], (ac_[k] << 1) | high, ac_[k]);
+				e_[k] = select(m[k], high, e_[k]);
+			}
+			break;
+		case OP_INC:
+			FOR_LANES(k)
+				ac_[k] = select(m[k], ac_[k] + 1, ac_[k]);
+			break;
+		case OP_SPA:
+			FOR_LANES(k)
+				pc_[k] = select(m[k] & to_mask((ac_[k] & (1 << 15)) == 0), pc_[k] + 1, pc_[k]);
+			break;
+		case OP_SNA:
+			FOR_LANES(k)
+				pc_[k] = select(m[k] & to_mask((ac_[k] & (1 << 15)) != 0), pc_[k] + 1, pc_[k]);
+			break;
+		case OP_SZA:
+			FOR_LANES(k)
+				pc_[k] = select(m[k] & to_mask(ac_[k] == 0), pc_[k] + 1, pc_[k]);
+			break;
+		case OP_SZE:
+			FOR_LANES(k)
+				pc_[k] = select(m[k] & to_mask(e_[k] == 0), pc_[k] + 1, pc_[k]);
+			break;
+		case OP_HLT:
+			FOR_LANES(k) {
+				pc_[k] = select(m[k], address, pc_[k]);
+				if (m[k]) {
+					halted_[k] = true;
+					running_[k] = 0;
+				}
+			}
+			break;
+
+		//IO instructions
+		case OP_INP:
+			FOR_LANES(k) {
+				ac_[k] = select(m[k], inpr_[k], ac_[k]);
+				fgi_[k] = select(m[k], 0, fgi_[k]);
+			}
+			return true;
+		case OP_OUT:
+			FOR_LANES(k) {
+				outr_[k] = select(m[k], ac_[k] & ((1 << 8) - 1), outr_[k]);
+				fgo_[k] = select(m[k], 0, fgo_[k]);
+			}
+			return true;
+		case OP_SKI:
+			FOR_LANES(k)
+				pc_[k] = select(m[k] & to_mask(fgi_[k] == 1), pc_[k] + 1, pc_[k]);
+			break;
+		case OP_SKO:
+			FOR_LANES(k)
+				pc_[k] = select(m[k] & to_mask(fgo_[k] == 1), pc_[k] + 1, pc_[k]);
+			break;
+		case OP_ION:
+			FOR_LANES(k)
+				ien_[k] = select(m[k], 1, ien_[k]);
+			break;
+		case OP_IOF:
+			FOR_LANES(k)
+				ien_[k] = select(m[k], 0, ien_[k]);
+			break;
+		default:
+			break;
+	}
+	return false;
+}
+
+void LockstepEngine::run(uint64_t max_steps) {
+	uint16_t stepped[LOCKSTEP_LANES], group[LOCKSTEP_LANES];
+	for (uint64_t step = 0; max_steps == 0 || step < max_steps; step++) {
+		//The lanes that execute a step in this round
+		unsigned remaining = 0;
+		FOR_LANES(k) {
+			stepped[k] = running_[k];
+			remaining |= unsigned(running_[k] & 1) << k;
+		}
+		if (remaining == 0)
+			break;
+
+		//The lanes with the R flag set run the interrupt cycle
+		unsigned interrupted = 0;
+		FOR_LANES(k) {
+			group[k] = stepped[k] & to_mask(r_[k] != 0);
+			interrupted |= unsigned(group[k] & 1) << k;
+		}
+		if (interrupted != 0)
+			interrupt(group);
+		remaining &= ~interrupted;
+
+		//Execute the lanes in groups that fetch the same word from the same address
+		unsigned serve = 0;
+		while (remaining != 0) {
+			int lead = 0;
+			while (!((remaining >> lead) & 1))
+				lead++;
+			uint16_t address = pc_[lead], word = memory_[address][lead];
+			unsigned members = 0;
+			FOR_LANES(k) {
+				group[k] = to_mask((remaining >> k) & 1) & to_mask(pc_[k] == address) & to_mask(memory_[address][k] == word);
+				members |= unsigned(group[k] & 1) << k;
+			}
+			if (execute_group(address, word, group))
+				serve |= members;
+			remaining &= ~members;
+		}
+
+		//Check the conditions for the R flag and keep the PC inside of the memory
+		FOR_LANES(k) {
+			r_[k] = select(stepped[k], ien_[k] & (fgo_[k] | fgi_[k]), r_[k]);
+			pc_[k] = (pc_[k] & ((1 << 12) - 1));
+			steps_[k] += (stepped[k] & 1);
+		}
+		for (int k = 0; serve != 0; k++, serve >>= 1)
+			if (serve & 1)
+				serve_devices(k);
+	}
+}
+
+void LockstepEngine::get_result(size_t lane, BatchResult &result) const {
+	result.error = false;
+	result.reason = halted_[lane] ? StopReason::Halt : StopReason::StepLimit;
+	result.steps = steps_[lane];
+	result.output = devices_[lane].output.bytes();
+	Registers &registers = result.registers;
+	registers.IR = ir_[lane];
+	registers.AC = ac_[lane];
+	registers.DR = dr_[lane];
+	registers.PC = pc_[lane];
+	registers.AR = ar_[lane];
+	registers.MAR = mar_[lane];
+	registers.TR = tr_[lane];
+	registers.I = i_[lane];
+	registers.E = e_[lane];
+	registers.R = r_[lane];
+	registers.IEN = ien_[lane];
+	registers.FGI = fgi_[lane];
+	registers.FGO = fgo_[lane];
+	registers.INPR = uint8_t(inpr_[lane]);
+	registers.OUTR = uint8_t(outr_[lane]);
+}
+
+void run_lockstep_lanes(const BatchProgram &program, const std::vector<BatchInput> &inputs, size_t first, uint64_t max_steps, BatchResult *results) {
+	//The engine is too large for the stack of a worker thread on some platforms
+	std::unique_ptr<LockstepEngine> engine(new LockstepEngine(program.memory));
+	size_t lanes = std::min(inputs.size() - first, size_t(LOCKSTEP_LANES));
+	for (size_t lane = 0; lane < lanes; lane++)
+		engine->set_input(lane, &inputs[first + lane].bytes);
+	engine->run(max_steps);
+	for (size_t lane = 0; lane < lanes; lane++)
+		engine->get_result(lane, results[lane]);
+}
+
+std::vector<BatchResult> run_lockstep(const BatchProgram &program, size_t program_index, const std::vector<BatchInput> &inputs, uint64_t max_steps, size_t thread_count) {
+	std::vector<BatchResult> results(inputs.size());
+	for (size_t i = 0; i < inputs.size(); i++) {
+		results[i].program = program_index;
+		results[i].input = i;
+		results[i].error = !program.error_text.empty();
+		results[i].reason = StopReason::Halt;
+		results[i].steps = 0;
+	}
+	if (!program.error_text.empty())
+		return results;
+
+	ThreadPool pool(thread_count);
+	for (size_t first = 0; first < inputs.size(); first += LOCKSTEP_LANES) {
+		BatchResult *lane_results = &results[first];
+		pool.submit([&program, &inputs, first, max_steps, lane_results] {
+			run_lockstep_lanes(program, inputs, first, max_steps, lane_results);
+		});
+	}
+	pool.wait();
+	return results;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "Batch.h"
+#include "Devices.h"
+#include <cstdint>
+#include <vector>
+
+//The number of machines that a lockstep engine runs together (16 lanes of 16 bits fill an AVX2 register)
+#define LOCKSTEP_LANES 16
+
+//Runs up to LOCKSTEP_LANES copies of a program in lockstep, each with its own input, for fuzzing a program over many
+//input sequences
+//The registers are kept in structure-of-arrays layout (one array of lanes for each register) and the memory is
+//interleaved (the words of all lanes at the same address are adjacent), so that an instruction is executed for all lanes
+//with the same loops over the lanes, which the compiler turns into SIMD instructions
+//The lanes whose PC has diverged are regrouped on each step: the lanes that fetch the same word from the same address
+//are executed together, the rest are masked out and executed in the next group
+//The devices behave the same as in run_with_input, so each lane gives the same result as running it on its own
+class LockstepEngine {
+	public:
+		//Load the memory image into all lanes and clear the registers
+		explicit LockstepEngine(const uint16_t memory[4096]);
+
+		//Set the input of a lane, the lanes without an input aren't run
+		void set_input(size_t lane, const std::vector<uint8_t> *input);
+
+		//Run all of the lanes until they halt or max_steps instructions are executed (0 means no limit)
+		void run(uint64_t max_steps);
+
+		//The result of a lane after run
+		void get_result(size_t lane, BatchResult &result) const;
+
+	protected:
+		//Execute an instruction word fetched from the given address for the lanes in the mask (0xFFFF for the lanes in
+		//the group, 0 for the rest)
+		//Returns true if the instruction is INP or OUT, so the devices have to be served
+		bool execute_group(uint16_t address, uint16_t word, const uint16_t mask[LOCKSTEP_LANES]);
+
+		//The interrupt cycle for the lanes in the mask
+		void interrupt(const uint16_t mask[LOCKSTEP_LANES]);
+
+		//Take the output byte and give the next input byte of a lane, the same as run_with_input
+		void serve_devices(size_t lane);
+
+		uint16_t memory_[4096][LOCKSTEP_LANES];
+		uint16_t ir_[LOCKSTEP_LANES], ac_[LOCKSTEP_LANES], dr_[LOCKSTEP_LANES], pc_[LOCKSTEP_LANES], ar_[LOCKSTEP_LANES], mar_[LOCKSTEP_LANES], tr_[LOCKSTEP_LANES];
+		//The flags are 0 or 1, and INPR and OUTR are widened to 16 bits, so all registers can use the same loops
+		uint16_t i_[LOCKSTEP_LANES], e_[LOCKSTEP_LANES], r_[LOCKSTEP_LANES], ien_[LOCKSTEP_LANES], fgi_[LOCKSTEP_LANES], fgo_[LOCKSTEP_LANES];
+		uint16_t inpr_[LOCKSTEP_LANES], outr_[LOCKSTEP_LANES];
+
+		//The lanes that are running (0xFFFF) and the lanes that have halted or have no input (0)
+		uint16_t running_[LOCKSTEP_LANES];
+		bool used_[LOCKSTEP_LANES], halted_[LOCKSTEP_LANES];
+		uint64_t steps_[LOCKSTEP_LANES];
+
+		//The devices of each lane, which keep the output of the lane
+		IODevices devices_[LOCKSTEP_LANES];
+};
+
+//Run a program with the inputs from first to first + LOCKSTEP_LANES (or the end of the inputs) on a lockstep engine, and
+//store the results of the lanes in results
+void run_lockstep_lanes(const BatchProgram &program, const std::vector<BatchInput> &inputs, size_t first, uint64_t max_steps, BatchResult *results);
+
+//Run a program with each of the inputs on lockstep engines, which are spread on a pool of threads (0 means one thread for
+//each core)
+//The results are in the order of the inputs, and are the same as the results of run_batch
+std::vector<BatchResult> run_lockstep(const BatchProgram &program, size_t program_index, const std::vector<BatchInput> &inputs, uint64_t max_steps, size_t thread_count);
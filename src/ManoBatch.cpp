@@ -0,0 +1,198 @@
+#include "Batch.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#if defined(_WIN32) || defined(_WIN64)
+	#include <windows.h>
+#else
+	#include <dirent.h>
+	#include <sys/stat.h>
+#endif
+
+//The default maximum number of instructions to execute for each run
+#define DEFAULT_MAX_STEPS 10000000ULL
+
+//Print the usage of the batch runner
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [-j threads] [-n max_steps] [-i inputs.txt] [-m manifest.txt] [source.txt | directory]...\n", program);
+	fprintf(stderr, "Assembles the given source files (and the txt files in the given directories and manifests) and runs each of\n");
+	fprintf(stderr, "them with each input sequence on all cores, printing one CSV record per run.\n");
+	fprintf(stderr, "  -j  The number of threads (default: one for each core)\n");
+	fprintf(stderr, "  -n  The maximum number of instructions of each run (default: %llu, 0 means no limit)\n", DEFAULT_MAX_STEPS);
+	fprintf(stderr, "  -i  A file with one input sequence on each line, as HEX bytes separated by spaces (default: no input)\n");
+	fprintf(stderr, "  -m  A file with the address of a source file on each line\n");
+}
+
+//Check whether the given address is a directory
+static bool is_directory(const std::string &address) {
+#if defined(_WIN32) || defined(_WIN64)
+	DWORD attributes = GetFileAttributesA(address.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+	struct stat info;
+	return stat(address.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+//Add the addresses of the txt files in the given directory to sources, in alphabetical order
+static void list_directory(const std::string &directory, std::vector<std::string> &sources) {
+	std::vector<std::string> names;
+#if defined(_WIN32) || defined(_WIN64)
+	WIN32_FIND_DATAA data;
+	HANDLE handle = FindFirstFileA((directory + "\\*.txt").c_str(), &data);
+	if (handle != INVALID_HANDLE_VALUE) {
+		do
+			names.push_back(data.cFileName);
+		while (FindNextFileA(handle, &data));
+		FindClose(handle);
+	}
+#else
+	DIR *dir = opendir(directory.c_str());
+	if (dir != nullptr) {
+		while (dirent *entry = readdir(dir)) {
+			std::string name = entry->d_name;
+			if (name.size() > 4 && name.compare(name.size() - 4, 4, ".txt") == 0)
+				names.push_back(name);
+		}
+		closedir(dir);
+	}
+#endif
+	std::sort(names.begin(), names.end());
+	for (const std::string &name : names)
+		sources.push_back(directory + "/" + name);
+}
+
+//Add the addresses in a manifest to sources, relative addresses are relative to the directory of the manifest
+static bool read_manifest(const std::string &address, std::vector<std::string> &sources) {
+	std::ifstream manifest(address);
+	if (!manifest.is_open())
+		return false;
+	std::string base = address.find_last_of("/\\") == std::string::npos ? "" : address.substr(0, address.find_last_of("/\\") + 1);
+	std::string line;
+	while (getline(manifest, line)) {
+		while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+			line.pop_back();
+		if (line.empty())
+			continue;
+		bool absolute = line[0] == '/' || line[0] == '\\' || (line.size() > 1 && line[1] == ':');
+		sources.push_back(absolute ? line : base + line);
+	}
+	return true;
+}
+
+//Read the input sequences, one on each line as HEX bytes separated by spaces (an empty line is an empty input)
+static bool read_inputs(const std::string &address, std::vector<BatchInput> &inputs) {
+	std::ifstream file(address);
+	if (!file.is_open())
+		return false;
+	std::string line;
+	for (int line_number = 1; getline(file, line); line_number++) {
+		BatchInput input;
+		input.name = address + ":" + std::to_string(line_number);
+		std::istringstream bytes(line);
+		std::string byte;
+		while (bytes >> byte) {
+			char *end;
+			unsigned long value = strtoul(byte.c_str(), &end, 16);
+			if (*end != '\0' || value > 255) {
+				fprintf(stderr, "%s: Invalid input byte '%s'.\n", input.name.c_str(), byte.c_str());
+				return false;
+			}
+			input.bytes.push_back(uint8_t(value));
+		}
+		inputs.push_back(input);
+	}
+	return true;
+}
+
+//Quote a CSV field if it has a comma, a quote or a line break
+static std::string csv_field(const std::string &s) {
+	if (s.find_first_of(",\"\r\n") == std::string::npos)
+		return s;
+	std::string result = "\"";
+	for (char c : s) {
+		if (c == '"')
+			result += '"';
+		result += c;
+	}
+	return result + "\"";
+}
+
+int main(int argc, char *argv[]) {
+	size_t thread_count = 0;
+	uint64_t max_steps = DEFAULT_MAX_STEPS;
+	std::vector<std::string> sources;
+	std::vector<BatchInput> inputs;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if ((argument == "-j" || argument == "-n" || argument == "-i" || argument == "-m") && i + 1 == argc) {
+			print_usage(argv[0]);
+			return 1;
+		}
+		if (argument == "-j")
+			thread_count = size_t(strtoull(argv[++i], nullptr, 10));
+		else if (argument == "-n")
+			max_steps = strtoull(argv[++i], nullptr, 10);
+		else if (argument == "-i") {
+			if (!read_inputs(argv[++i], inputs)) {
+				fprintf(stderr, "Failed to read the inputs from %s.\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (argument == "-m") {
+			if (!read_manifest(argv[++i], sources)) {
+				fprintf(stderr, "Failed to read the manifest %s.\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (!argument.empty() && argument[0] == '-') {
+			print_usage(argv[0]);
+			return 1;
+		}
+		else if (is_directory(argument))
+			list_directory(argument, sources);
+		else
+			sources.push_back(argument);
+	}
+	if (sources.empty()) {
+		print_usage(argv[0]);
+		return 1;
+	}
+	//Without an inputs file, each program is run once without any input
+	if (inputs.empty())
+		inputs.push_back(BatchInput{"", {}});
+
+	std::vector<BatchProgram> programs(sources.size());
+	for (size_t i = 0; i < sources.size(); i++)
+		load_batch_program(sources[i], programs[i]);
+
+	std::vector<BatchResult> results = run_batch(programs, inputs, max_steps, thread_count);
+
+	//One record for each run, the output bytes are written in HEX
+	printf("program,input,status,steps,AC,output,error\n");
+	int failures = 0;
+	for (const BatchResult &result : results) {
+		const char *status = "halt";
+		if (result.error)
+			status = "error";
+		else if (result.reason != StopReason::Halt)
+			status = "step_limit";
+		if (result.error || result.reason != StopReason::Halt)
+			failures++;
+		std::string output;
+		char hex[4];
+		for (size_t i = 0; i < result.output.size(); i++) {
+			snprintf(hex, sizeof(hex), i == 0 ? "%02X" : " %02X", result.output[i]);
+			output += hex;
+		}
+		printf("%s,%s,%s,%llu,%04X,%s,%s\n", csv_field(programs[result.program].name).c_str(), csv_field(inputs[result.input].name).c_str(),
+			status, (unsigned long long)result.steps, result.registers.AC, output.c_str(), csv_field(programs[result.program].error_text).c_str());
+	}
+
+	return failures == 0 ? 0 : 2;
+}
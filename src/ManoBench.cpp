@@ -0,0 +1,322 @@
+#include "Assembler.h"
+#include "Batch.h"
+#include "BlockCache.h"
+#include "Computer.h"
+#include "Devices.h"
+#include "History.h"
+#include "Refresh.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+//The maximum number of instructions of a workload, a workload that doesn't halt before it is broken
+#define MAX_WORKLOAD_STEPS 100000000ULL
+
+//Each measurement repeats its workload for at least this long, and the best of BENCH_TRIALS measurements is kept
+#define DEFAULT_MIN_MILLISECONDS 60
+#define BENCH_TRIALS 5
+
+//A measurement that is slower than the threshold is repeated at most this many times before it counts as a regression, so
+//that a moment of noise on a busy machine doesn't fail the benchmark
+#define BENCH_RETRIES 2
+
+//A metric fails when its ratio to the step metric is below the baseline ratio by more than this percentage (the threshold
+//leaves room for the noise of a busy machine, and still catches a lost optimization)
+#define DEFAULT_THRESHOLD 40.0
+
+//The exit code when there is no baseline to compare with, CTest reports the benchmark as skipped
+#define BENCH_SKIPPED 77
+
+//The GUI bridge is measured on the first steps of each workload, the GUI executes a step at a time anyway
+#define BRIDGE_STEPS 10000
+
+//The number of bytes that the echo workload reads (the last one is the 0 that stops it)
+#define ECHO_BYTES 2048
+
+//A canonical program of the benchmark, its source is <name>.txt in the workload directory
+struct Workload {
+	const char *name;
+	bool echo;	//The program echoes the input bytes with interrupts, so it is run with the input and output devices
+};
+
+static const Workload workloads[] = {
+	{"multiply", false},
+	{"fibonacci", false},
+	{"bubble_sort", false},
+	{"echo", true}
+};
+
+//A measured metric, all of them are rates, so higher is better
+//The rates depend on the machine, so they are compared with the baseline as ratios to the step metric of the same workload
+//(Computer::step, the reference interpreter), which are the same on a faster or a slower machine
+struct Measurement {
+	std::string workload, metric, unit;
+	double value, ratio;
+};
+
+//Print the usage of the benchmark
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [-b baseline.txt] [-w] [-t threshold] [-m milliseconds] <workload directory>\n", program);
+	fprintf(stderr, "Measures the assembler (lines/s), the interpreters (instructions/s) and the per-step cost of the GUI bridge\n");
+	fprintf(stderr, "(steps/s) on the canonical workloads, and compares their ratios to Computer::step with a baseline.\n");
+	fprintf(stderr, "  -b  The baseline file, the comparison is skipped (exit code %d) if it isn't given or doesn't exist\n", BENCH_SKIPPED);
+	fprintf(stderr, "  -w  Write the ratios to the baseline file instead of comparing them\n");
+	fprintf(stderr, "  -t  Fail when a ratio is below the baseline by more than this percentage (default: %g)\n", DEFAULT_THRESHOLD);
+	fprintf(stderr, "  -m  Repeat each measurement for at least this many milliseconds (default: %d)\n", DEFAULT_MIN_MILLISECONDS);
+}
+
+//Measure the rate of a piece of work: run() is repeated for at least min_milliseconds and returns the number of units (lines or
+//steps) that it has done, the best rate of BENCH_TRIALS trials is returned
+//If the rate is below minimum, the trials are repeated (see BENCH_RETRIES)
+static double measure(const std::function<uint64_t()> &run, uint64_t min_milliseconds, double minimum) {
+	double best = 0;
+	for (int attempt = 0; attempt <= BENCH_RETRIES && (attempt == 0 || best < minimum); attempt++) {
+		for (int trial = 0; trial < BENCH_TRIALS; trial++) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::chrono::duration<double> elapsed(0);
+			uint64_t units = 0;
+			do {
+				units += run();
+				elapsed = std::chrono::steady_clock::now() - start;
+			} while (elapsed < std::chrono::milliseconds(min_milliseconds));
+			best = std::max(best, double(units) / elapsed.count());
+		}
+	}
+	return best;
+}
+
+//The input of the echo workload: printable bytes, and a 0 at the end
+static std::vector<uint8_t> echo_input() {
+	std::vector<uint8_t> input;
+	for (int i = 0; i < ECHO_BYTES - 1; i++)
+		input.push_back(uint8_t(' ' + i % 95));
+	input.push_back(0);
+	return input;
+}
+
+//Read a baseline file, with one "workload metric ratio" record on each line
+static bool read_baseline(const std::string &address, std::map<std::string, double> &baseline) {
+	std::ifstream file(address);
+	if (!file.is_open())
+		return false;
+	std::string workload, metric;
+	double value;
+	while (file >> workload >> metric >> value)
+		baseline[workload + " " + metric] = value;
+	return true;
+}
+
+//Write the measurements as a baseline file
+static bool write_baseline(const std::string &address, const std::vector<Measurement> &measurements) {
+	std::ofstream file(address);
+	for (const Measurement &measurement : measurements)
+		file << measurement.workload << " " << measurement.metric << " " << measurement.ratio << "\n";
+	return bool(file);
+}
+
+int main(int argc, char *argv[]) {
+	std::string baseline_address, directory;
+	bool overwrite = false;
+	double threshold = DEFAULT_THRESHOLD;
+	uint64_t min_milliseconds = DEFAULT_MIN_MILLISECONDS;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "-b" && i + 1 < argc)
+			baseline_address = argv[++i];
+		else if (argument == "-w")
+			overwrite = true;
+		else if (argument == "-t" && i + 1 < argc)
+			threshold = strtod(argv[++i], nullptr);
+		else if (argument == "-m" && i + 1 < argc)
+			min_milliseconds = strtoull(argv[++i], nullptr, 10);
+		else if (!argument.empty() && argument[0] != '-' && directory.empty())
+			directory = argument;
+		else {
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+	if (directory.empty() || (overwrite && baseline_address.empty())) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	std::map<std::string, double> baseline;
+	bool has_baseline = !baseline_address.empty() && !overwrite && read_baseline(baseline_address, baseline);
+	//The slowest rate of a metric that isn't a regression, given the rate of the step metric of its workload (0 if the
+	//metric isn't in the baseline)
+	auto minimum = [&](const std::string &workload, const std::string &metric, double step_rate) {
+		std::map<std::string, double>::const_iterator old = baseline.find(workload + " " + metric);
+		return old == baseline.end() ? 0.0 : old->second * step_rate * (1 - threshold / 100);
+	};
+
+	std::vector<uint8_t> input = echo_input();
+	std::vector<Measurement> measurements;
+	for (const Workload &workload : workloads) {
+		std::string address = directory + "/" + workload.name + ".txt", error_text;
+		std::vector<SourceLine> lines;
+		SymbolTable symbols;
+		uint16_t image[4096] = {};
+		if (!load_source_file(address, lines, error_text) || !assemble(lines, image, symbols, error_text)) {
+			fprintf(stderr, "%s: %s\n", address.c_str(), error_text.c_str());
+			return 1;
+		}
+
+		//Run a fresh copy of the program until it halts, returns the number of steps (0 if it didn't halt)
+		//The echo workload is run with the devices of the batch runner
+		Computer computer;
+		BatchResult result;
+		auto run = [&]() -> uint64_t {
+			computer.reset_registers();
+			std::memcpy(computer.memory, image, sizeof(image));
+			uint64_t steps = 0;
+			if (workload.echo) {
+				result.output.clear();
+				run_with_input(computer, input, MAX_WORKLOAD_STEPS, result);
+				return result.reason == StopReason::Halt ? result.steps : 0;
+			}
+			return computer.run(MAX_WORKLOAD_STEPS, 0, steps) == StopReason::Halt ? steps : 0;
+		};
+
+		//A benchmark of a broken workload means nothing, so it is checked first
+		uint64_t steps = run();
+		if (steps == 0 || (workload.echo && result.output != input)) {
+			fprintf(stderr, "%s: The workload didn't halt with the expected result.\n", address.c_str());
+			return 1;
+		}
+
+		//The reference of the ratios: the same run with Computer::step, which the observer of Computer::run forces
+		Computer stepped;
+		auto run_steps = [&]() -> uint64_t {
+			stepped.reset_registers();
+			std::memcpy(stepped.memory, image, sizeof(image));
+			IODevices devices;
+			if (workload.echo) {
+				devices.input.push(input.data(), input.size());
+				devices.attach(stepped.registers);
+			}
+			uint64_t stepped_steps;
+			stepped.run(MAX_WORKLOAD_STEPS, 0, stepped_steps, [&](const std::pair<int, uint16_t> &, bool) {
+				if (workload.echo)
+					devices.serve(stepped.registers);
+			});
+			return stepped_steps;
+		};
+		if (run_steps() != steps || std::memcmp(stepped.memory, computer.memory, sizeof(stepped.memory)) != 0) {
+			fprintf(stderr, "%s: Computer::step and the interpreter disagree.\n", address.c_str());
+			return 1;
+		}
+		double step_rate = measure(run_steps, min_milliseconds, 0);
+		measurements.push_back(Measurement{workload.name, "step", "instructions/s", step_rate, 1});
+
+		measurements.push_back(Measurement{workload.name, "assemble", "lines/s", measure([&]() -> uint64_t {
+			assemble(lines, image, symbols, error_text);
+			return lines.size();
+		}, min_milliseconds, minimum(workload.name, "assemble", step_rate)), 0});
+		measurements.push_back(Measurement{workload.name, "interpret", "instructions/s", measure(run, min_milliseconds, minimum(workload.name, "interpret", step_rate)), 0});
+
+		//The block cache of the command-line runner has no devices, so it is only measured on the other workloads
+		if (!workload.echo) {
+			Computer cached;
+			BlockCache block_cache(cached);
+			cached.reset_registers();
+			std::memcpy(cached.memory, image, sizeof(image));
+			block_cache.flush();
+			uint64_t cached_steps;
+			block_cache.run(MAX_WORKLOAD_STEPS, 0, cached_steps);
+			if (cached_steps != steps || std::memcmp(cached.memory, computer.memory, sizeof(cached.memory)) != 0) {
+				fprintf(stderr, "%s: The block cache and the interpreter disagree.\n", address.c_str());
+				return 1;
+			}
+			measurements.push_back(Measurement{workload.name, "block_cache", "instructions/s", measure([&]() -> uint64_t {
+				cached.reset_registers();
+				std::memcpy(cached.memory, image, sizeof(image));
+				block_cache.flush();
+				block_cache.run(MAX_WORKLOAD_STEPS, 0, cached_steps);
+				return cached_steps;
+			}, min_milliseconds, minimum(workload.name, "block_cache", step_rate)), 0});
+		}
+
+		//The GUI bridge: each step is recorded in the history and turned into the commands that refresh the GUI, and the
+		//changed memory line is fetched again, the same as the Execute next button (the javascript isn't evaluated)
+		History history;
+		Breakpoints breakpoints;
+		std::string command, rows;
+		measurements.push_back(Measurement{workload.name, "bridge", "steps/s", measure([&]() -> uint64_t {
+			computer.reset_registers();
+			std::memcpy(computer.memory, image, sizeof(image));
+			history.start(computer);
+			RefreshBuilder refresh_builder;
+			Registers &registers = computer.registers;
+			IODevices devices;
+			if (workload.echo) {
+				devices.input.push(input.data(), input.size());
+				devices.attach(registers);
+			}
+			Registers before = registers;
+			uint64_t bridge_steps;
+			computer.run(BRIDGE_STEPS, 0, bridge_steps, [&](const std::pair<int, uint16_t> &data_change, bool) {
+				if (workload.echo)
+					devices.serve(registers);
+				history.push(before, registers, data_change, computer.memory);
+				refresh_builder.mark_row_dirty(data_change.first);
+				command.clear();
+				refresh_builder.refresh(command, registers, history.previous(registers), history.first(), history.position(), history.end());
+				rows.clear();
+				memory_rows(rows, computer.memory, data_change.first, 1, breakpoints);
+				before = registers;
+			});
+			return bridge_steps;
+		}, min_milliseconds, minimum(workload.name, "bridge", step_rate)), 0});
+
+		//The ratios to the step metric of this workload
+		for (Measurement &measurement : measurements)
+			if (measurement.workload == workload.name)
+				measurement.ratio = measurement.value / step_rate;
+	}
+
+	//Compare the ratios with the baseline
+	bool regression = false;
+	printf("%-12s %-12s %16s %-16s %8s %8s %8s\n", "workload", "metric", "rate", "unit", "ratio", "baseline", "change");
+	for (const Measurement &measurement : measurements) {
+		printf("%-12s %-12s %16.0f %-16s %8.4g", measurement.workload.c_str(), measurement.metric.c_str(), measurement.value, measurement.unit.c_str(), measurement.ratio);
+		std::map<std::string, double>::const_iterator old = baseline.find(measurement.workload + " " + measurement.metric);
+		if (old == baseline.end() || old->second <= 0) {
+			printf(" %8s %8s\n", "-", "-");
+			continue;
+		}
+		double change = 100.0 * (measurement.ratio - old->second) / old->second;
+		bool failed = (change < -threshold);
+		regression = regression || failed;
+		printf(" %8.4g %+7.1f%%%s\n", old->second, change, failed ? "  REGRESSION" : "");
+	}
+
+	if (overwrite) {
+		if (!write_baseline(baseline_address, measurements)) {
+			fprintf(stderr, "Failed to write the baseline to %s.\n", baseline_address.c_str());
+			return 1;
+		}
+		printf("The baseline has been written to %s.\n", baseline_address.c_str());
+		return 0;
+	}
+	if (baseline_address.empty()) {
+		printf("No baseline has been given, the comparison is skipped.\n");
+		return BENCH_SKIPPED;
+	}
+	if (!has_baseline) {
+		printf("There is no baseline in %s, the comparison is skipped (-w writes one).\n", baseline_address.c_str());
+		return BENCH_SKIPPED;
+	}
+	if (regression) {
+		printf("Some ratios are more than %g%% below the baseline.\n", threshold);
+		return 2;
+	}
+	return 0;
+}
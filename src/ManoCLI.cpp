@@ -0,0 +1,260 @@
+#include "Assembler.h"
+#include "BlockCache.h"
+#include "Computer.h"
+#include "ControlUnit.h"
+#include "Devices.h"
+#include "Image.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include <bitset>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//The default maximum number of instructions to execute before giving up on reaching a halt
+#define DEFAULT_MAX_STEPS 100000000ULL
+
+//The number of loops in the hot loop report of the profiler
+#define REPORTED_LOOPS 10
+
+//Print the usage of the command-line runner
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s [-p profile | -c clock_hz] [-o image.mano] [-x|-r|-w address]... [-b condition]... [-t run.trace] [-I input] [-O output] <source.txt | image.mano> [max_steps]\n", program);
+	fprintf(stderr, "Assembles the given source file (or loads the given memory image), runs it until HLT and prints the final\n");
+	fprintf(stderr, "registers and memory.\n");
+	fprintf(stderr, "At most max_steps instructions are executed (default: %llu, 0 means no limit).\n", DEFAULT_MAX_STEPS);
+	fprintf(stderr, "  -p  Profile the execution, print the hot loops and write profile.csv and profile.folded (for flame graphs)\n");
+	fprintf(stderr, "  -o  Save the assembled program as a memory image before running it\n");
+	fprintf(stderr, "  -x  Stop before the instruction at the given HEX address is executed (except for the first instruction)\n");
+	fprintf(stderr, "  -r  Stop after an instruction has read the word at the given HEX address\n");
+	fprintf(stderr, "  -w  Stop after an instruction has written the word at the given HEX address\n");
+	fprintf(stderr, "  -b  Stop after a step that has made the condition true, e.g. \"PC == 0x120 && AC < 0\" or \"E != old(E)\"\n");
+	fprintf(stderr, "  -t  Record a trace of the run (see ManoTrace)\n");
+	fprintf(stderr, "  -I  Attach the input device, which gives the bytes of the file (- for the standard input) through INPR\n");
+	fprintf(stderr, "  -O  Attach the output device, which writes every OUT byte to the file (- for the standard output)\n");
+	fprintf(stderr, "  -c  Run clock cycle by clock cycle, print the cycles per instruction and the runtime at the given clock rate\n");
+}
+
+//Print the register values in binary and HEX
+static void print_registers(const Registers &registers) {
+	printf("IR   %s %04X\n", std::bitset<16>(registers.IR).to_string().c_str(), registers.IR);
+	printf("I    %d\n", int(registers.I));
+	printf("AC   %s %04X\n", std::bitset<16>(registers.AC).to_string().c_str(), registers.AC);
+	printf("DR   %s %04X\n", std::bitset<16>(registers.DR).to_string().c_str(), registers.DR);
+	printf("PC   %s %03X\n", std::bitset<12>(registers.PC).to_string().c_str(), registers.PC);
+	printf("AR   %s %03X\n", std::bitset<12>(registers.AR).to_string().c_str(), registers.AR);
+	printf("MAR  %s %04X\n", std::bitset<16>(registers.MAR).to_string().c_str(), registers.MAR);
+	printf("E    %d\n", int(registers.E));
+	printf("TR   %s %04X\n", std::bitset<16>(registers.TR).to_string().c_str(), registers.TR);
+	printf("R    %d\n", int(registers.R));
+	printf("IEN  %d\n", int(registers.IEN));
+	printf("FGI  %d\n", int(registers.FGI));
+	printf("FGO  %d\n", int(registers.FGO));
+	printf("INPR %s %02X\n", std::bitset<8>(registers.INPR).to_string().c_str(), registers.INPR);
+	printf("OUTR %s %02X\n", std::bitset<8>(registers.OUTR).to_string().c_str(), registers.OUTR);
+}
+
+//Print the clock cycles of the run: in total, per instruction and per operation, and the runtime at the clock rate
+static void print_cycles(const ControlUnit &control_unit, double clock_hz) {
+	uint64_t cycles = control_unit.cycles(), instructions = control_unit.instructions();
+	printf("Clock cycles: %llu\n", (unsigned long long)cycles);
+	printf("Cycles per instruction: %.3f\n", instructions == 0 ? 0.0 : double(cycles) / double(instructions));
+	printf("Runtime at %g Hz: %g s\n", clock_hz, double(cycles) / clock_hz);
+	for (int operation = 0; operation <= INTERRUPT_CYCLE; operation++) {
+		uint64_t count = control_unit.operation_count(operation);
+		if (count != 0)
+			printf("  %-9s %12llu instructions %14llu cycles\n", operation == INTERRUPT_CYCLE ? "INTERRUPT" : operation_name(operation),
+				(unsigned long long)count, (unsigned long long)control_unit.operation_cycles(operation));
+	}
+}
+
+//Print the memory in rows of 8 words, rows that only contain zeros are skipped
+static void print_memory(const uint16_t memory[4096]) {
+	for (int row = 0; row < 4096; row += 8) {
+		bool empty = true;
+		for (int i = row; i < row + 8; i++)
+			if (memory[i] != 0)
+				empty = false;
+		if (empty)
+			continue;
+		printf("%03X:", row);
+		for (int i = row; i < row + 8; i++)
+			printf(" %04X", memory[i]);
+		printf("\n");
+	}
+}
+
+int main(int argc, char *argv[]) {
+	std::string profile, image, trace, input, output;
+	double clock_hz = 0;
+	Breakpoints breakpoints;
+	std::vector<std::string> arguments;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "-p" && i + 1 < argc)
+			profile = argv[++i];
+		else if (argument == "-o" && i + 1 < argc)
+			image = argv[++i];
+		else if (argument == "-t" && i + 1 < argc)
+			trace = argv[++i];
+		else if (argument == "-I" && i + 1 < argc)
+			input = argv[++i];
+		else if (argument == "-O" && i + 1 < argc)
+			output = argv[++i];
+		else if (argument == "-c" && i + 1 < argc)
+			clock_hz = strtod(argv[++i], nullptr);
+		else if ((argument == "-x" || argument == "-r" || argument == "-w") && i + 1 < argc) {
+			char *end;
+			long address = strtol(argv[++i], &end, 16);
+			if (*end != '\0' || address < 0 || address >= 4096) {
+				print_usage(argv[0]);
+				return 1;
+			}
+			breakpoints.set(argument == "-x" ? BREAK_EXECUTE : (argument == "-r" ? BREAK_READ : BREAK_WRITE), int(address), true);
+		}
+		else if (argument == "-b" && i + 1 < argc) {
+			Condition condition;
+			std::string error_text;
+			if (!condition.compile(argv[++i], error_text)) {
+				fprintf(stderr, "%s\n", error_text.c_str());
+				return 1;
+			}
+			breakpoints.add_condition(condition);
+		}
+		else if (!argument.empty() && argument[0] == '-') {
+			print_usage(argv[0]);
+			return 1;
+		}
+		else
+			arguments.push_back(argument);
+	}
+	//The control unit runs on its own, so it can't be used with the profiler, the breakpoints, the trace or the devices
+	bool devices_attached = (!input.empty() || !output.empty());
+	if (arguments.size() < 1 || arguments.size() > 2 || clock_hz < 0 || (clock_hz > 0 && (!profile.empty() || !breakpoints.empty() || !trace.empty() || devices_attached))) {
+		print_usage(argv[0]);
+		return 1;
+	}
+	uint64_t max_steps = DEFAULT_MAX_STEPS;
+	if (arguments.size() == 2)
+		max_steps = strtoull(arguments[1].c_str(), nullptr, 10);
+
+	Computer computer;
+	SymbolTable symbols;
+	int source_map[4096];
+	std::string error_text;
+	//A memory image is loaded as it is, a source file is parsed and assembled
+	if (is_image_address(arguments[0])) {
+		if (!load_image(arguments[0], computer, symbols, source_map, error_text)) {
+			fprintf(stderr, "%s\n", error_text.c_str());
+			return 1;
+		}
+	}
+	else {
+		std::vector<SourceLine> lines;
+		if (!load_source_file(arguments[0], lines, error_text) || !assemble(lines, computer.memory, symbols, error_text, source_map)) {
+			fprintf(stderr, "%s\n", error_text.c_str());
+			return 1;
+		}
+	}
+	if (!image.empty() && !save_image(image, computer, symbols, source_map, error_text)) {
+		fprintf(stderr, "%s\n", error_text.c_str());
+		return 1;
+	}
+
+	//Run the program until it halts, the maximum number of steps is reached or a breakpoint is hit
+	uint64_t steps = 0;
+	StopReason reason;
+	Profiler profiler;
+	IODevices devices;
+	ControlUnit control_unit(computer);
+	if (clock_hz > 0)
+		reason = control_unit.run(max_steps, 0, steps);
+	else if (profile.empty() && breakpoints.empty() && trace.empty() && !devices_attached) {
+		BlockCache block_cache(computer);
+		reason = block_cache.run(max_steps, 0, steps);
+	}
+	//The profiler, the watchpoints, the trace and the devices look at every step, so the program is run with an observer
+	//instead of the block cache
+	else {
+		if ((!input.empty() && !devices.input.open(input, error_text)) || (!output.empty() && !devices.output.open(output, error_text))) {
+			fprintf(stderr, "%s\n", error_text.c_str());
+			return 1;
+		}
+		if (devices_attached)
+			devices.attach(computer.registers);
+		TraceWriter trace_writer;
+		if (!trace.empty() && !trace_writer.open(trace, computer, error_text)) {
+			fprintf(stderr, "%s\n", error_text.c_str());
+			return 1;
+		}
+		//The registers before and after the last step tell which breakpoint has stopped the run
+		Registers before = computer.registers, previous = before;
+		int watched = -1;
+		profiler.start(computer);
+		reason = computer.run_with_breakpoints(max_steps, 0, steps, breakpoints, [&](const std::pair<int, uint16_t> &data_change, bool) {
+			if (!profile.empty())
+				profiler.record(computer);
+			if (!breakpoints.empty())
+				watched = computer.watched_address(before.R, data_change, breakpoints);
+			if (!trace.empty())
+				trace_writer.record(before, data_change, computer);
+			if (devices_attached)
+				devices.serve(computer.registers);
+			previous = before;
+			before = computer.registers;
+		});
+		if (!trace_writer.close(error_text) || !devices.output.close(error_text)) {
+			fprintf(stderr, "%s\n", error_text.c_str());
+			return 1;
+		}
+		int condition = -1;
+		if (reason == StopReason::Breakpoint && watched == -1)
+			condition = breakpoints.true_condition(previous, computer.registers, computer.memory);
+		if (reason == StopReason::Breakpoint && watched != -1)
+			printf("Stopped by the watchpoint at %03X after %llu steps.\n", watched, (unsigned long long)steps);
+		else if (reason == StopReason::Breakpoint && condition != -1)
+			printf("Stopped by the condition \"%s\" after %llu steps.\n", breakpoints.conditions()[condition].text().c_str(), (unsigned long long)steps);
+		else if (reason == StopReason::Breakpoint)
+			printf("Stopped at the breakpoint at %03X after %llu steps.\n", computer.registers.PC, (unsigned long long)steps);
+	}
+	bool halt = (reason == StopReason::Halt);
+
+	if (halt)
+		printf("Execution finished after %llu steps.\n", (unsigned long long)steps);
+	else if (reason != StopReason::Breakpoint)
+		printf("Execution stopped after %llu steps without reaching a halt.\n", (unsigned long long)steps);
+	if (devices_attached) {
+		printf("The program has read %llu bytes and written %llu bytes.\n", (unsigned long long)devices.input.count(), (unsigned long long)devices.output.count());
+		//Without an output file, the output is printed with the results
+		if (output.empty()) {
+			std::string text;
+			devices.output.take(text);
+			printf("Output: %s\n", text.c_str());
+		}
+	}
+	print_registers(computer.registers);
+	printf("\n");
+	print_memory(computer.memory);
+
+	if (clock_hz > 0) {
+		printf("\n");
+		print_cycles(control_unit, clock_hz);
+	}
+
+	if (!profile.empty()) {
+		printf("\n");
+		profiler.write_report(std::cout, source_map, symbols, REPORTED_LOOPS);
+		std::ofstream csv(profile + ".csv"), folded(profile + ".folded");
+		profiler.write_csv(csv, source_map, symbols);
+		profiler.write_collapsed(folded, symbols);
+		if (!csv || !folded) {
+			fprintf(stderr, "Failed to write the profile to %s.csv and %s.folded.\n", profile.c_str(), profile.c_str());
+			return 1;
+		}
+	}
+
+	return halt ? 0 : 2;
+}
@@ -0,0 +1,1070 @@
+#include "Assembler.h"
+#include "Batch.h"
+#include "BlockCache.h"
+#include "Breakpoints.h"
+#include "Computer.h"
+#include "Condition.h"
+#include "ControlUnit.h"
+#include "Devices.h"
+#include "History.h"
+#include "Image.h"
+#include "Lockstep.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//The number of random programs of each test, and the number of steps that each of them is run for
+#define RANDOM_PROGRAMS 50
+#define RANDOM_STEPS 3000
+
+//The number of checks that have failed
+static int failures = 0;
+
+//Report a check that has failed
+static void check(bool condition, const std::string &message) {
+	if (!condition) {
+		fprintf(stderr, "FAILED: %s\n", message.c_str());
+		failures++;
+	}
+}
+
+//A small xorshift generator, so that the random programs are the same on every platform
+struct Random {
+	uint32_t state;
+
+	explicit Random(uint32_t seed) : state(seed == 0 ? 1 : seed) {}
+
+	uint32_t next() {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+};
+
+//Fill the memory with a random program, a quarter of the words are register-reference and a quarter IO instructions, so
+//that the skips, the flags and the interrupts are reached too
+static void random_program(Random &random, uint16_t memory[4096]) {
+	for (int i = 0; i < 4096; i++) {
+		uint32_t value = random.next();
+		switch (value & 3) {
+			case 0: memory[i] = uint16_t(0x7000 | (1 << ((value >> 2) % 12))); break;
+			case 1: memory[i] = uint16_t(0xF000 | (1 << (6 + (value >> 2) % 6))); break;
+			default: memory[i] = uint16_t(value >> 8); break;
+		}
+	}
+}
+
+//Random registers, with the flags and INPR set so that the IO instructions have something to do
+static void random_registers(Random &random, Registers &registers) {
+	registers.IR = uint16_t(random.next());
+	registers.AC = uint16_t(random.next());
+	registers.DR = uint16_t(random.next());
+	registers.PC = uint16_t(random.next() & 0x0FFF);
+	registers.AR = uint16_t(random.next() & 0x0FFF);
+	registers.MAR = uint16_t(random.next());
+	registers.TR = uint16_t(random.next());
+	uint32_t flags = random.next();
+	registers.I = (flags & 1);
+	registers.E = ((flags >> 1) & 1);
+	registers.R = false;
+	registers.IEN = ((flags >> 2) & 1);
+	registers.FGI = ((flags >> 3) & 1);
+	registers.FGO = ((flags >> 4) & 1);
+	registers.INPR = uint8_t(flags >> 8);
+	registers.OUTR = uint8_t(flags >> 16);
+}
+
+//The names of the registers that differ between a and b, separated by spaces (empty if they are the same)
+static std::string differing_registers(const Registers &a, const Registers &b) {
+	std::string names;
+	#define COMPARE(name) \
+		if (a.name != b.name) \
+			names += (names.empty() ? "" : " ") + std::string(#name)
+	COMPARE(IR); COMPARE(AC); COMPARE(DR); COMPARE(PC); COMPARE(AR); COMPARE(MAR); COMPARE(TR);
+	COMPARE(I); COMPARE(E); COMPARE(R); COMPARE(IEN); COMPARE(FGI); COMPARE(FGO); COMPARE(INPR); COMPARE(OUTR);
+	#undef COMPARE
+	return names;
+}
+
+//Check that two computers have the same registers and memory
+static void check_same(const Computer &a, const Computer &b, const std::string &name) {
+	std::string differences = differing_registers(a.registers, b.registers);
+	check(differences.empty(), name + ": the registers differ (" + differences + ")");
+	check(std::memcmp(a.memory, b.memory, sizeof(a.memory)) == 0, name + ": the memories differ");
+}
+
+//Assemble a program that is given as the lines of a txt source file
+static bool assemble_text(const std::vector<std::string> &text, uint16_t memory[4096], SymbolTable &symbols, std::string &error_text, int *source_map = nullptr) {
+	std::vector<SourceLine> lines(text.size());
+	for (size_t i = 0; i < text.size(); i++)
+		parse_source_line(text[i], lines[i]);
+	return assemble(lines, memory, symbols, error_text, source_map);
+}
+
+static bool assemble_text(const std::vector<std::string> &text, uint16_t memory[4096], std::string &error_text) {
+	SymbolTable symbols;
+	return assemble_text(text, memory, symbols, error_text);
+}
+
+//Multiply 13 by 11 with repeated additions, it halts after 55 steps with 143 in RES
+static const std::vector<std::string> multiply_source = {
+	"\tORG 0",
+	"LOP,\tLDA RES",
+	"\tADD A",
+	"\tSTA RES",
+	"\tISZ CNT",
+	"\tBUN LOP",
+	"\tHLT",
+	"A,\tDEC 13",
+	"CNT,\tDEC -11",
+	"RES,\tDEC 0",
+	"\tEND"
+};
+
+//Echo the input bytes in the interrupt service routine until a 0 byte (the echo workload of the benchmark)
+static const std::vector<std::string> echo_source = {
+	"\tORG 0",
+	"ZRO,\tBUN MAI",
+	"\tBUN SRV",
+	"MAI,\tION",
+	"\tLDA DON",
+	"\tSZA",
+	"\tBUN FIN",
+	"\tBUN MAI",
+	"FIN,\tHLT",
+	"SRV,\tSTA SAC",
+	"\tSKI",
+	"\tBUN RET",
+	"\tINP",
+	"\tOUT",
+	"\tSZA",
+	"\tBUN RET",
+	"\tISZ DON",
+	"RET,\tLDA SAC",
+	"\tBUN ZRO I",
+	"SAC,\tHEX 0",
+	"DON,\tDEC 0",
+	"\tEND"
+};
+
+//Check that the computer is in the recorded state of a step
+static void check_state(const Computer &computer, const std::vector<Computer> &states, uint64_t step, const std::string &name) {
+	check_same(states[size_t(step)], computer, name + " to step " + std::to_string(step));
+}
+
+//Going back and forth in a history gives the same states as the run that has been recorded
+static void test_history() {
+	Random random(3);
+	for (int program = 0; program < RANDOM_PROGRAMS / 5; program++) {
+		std::string name = "random program " + std::to_string(program);
+		Computer computer;
+		random_program(random, computer.memory);
+		random_registers(random, computer.registers);
+		//A large history keeps every step, a small one drops the oldest records and checkpoints
+		History large(1 << 20, 16), small(4096, 16);
+		large.start(computer);
+		small.start(computer);
+
+		//The state before each step, and the state at the end
+		std::vector<Computer> states;
+		std::pair<int, uint16_t> data_change;
+		for (int step = 0; step < RANDOM_STEPS / 5; step++) {
+			//Now and then the inputs are changed between two steps, as the user or an input device does
+			if (random.next() % 8 == 0) {
+				computer.registers.INPR = uint8_t(random.next());
+				computer.registers.FGI = !computer.registers.FGI;
+				computer.registers.FGO = ((random.next() & 1) != 0);
+			}
+			states.push_back(computer);
+			Registers before = computer.registers;
+			computer.step(data_change);
+			large.push(before, computer.registers, data_change, computer.memory);
+			small.push(before, computer.registers, data_change, computer.memory);
+		}
+		states.push_back(computer);
+
+		History *histories[2] = {&large, &small};
+		for (History *history : histories) {
+			std::string history_name = name + (history == &large ? ", large history" : ", small history");
+			check(history->end() == states.size() - 1, history_name + ": the end isn't the last step");
+			check(history == &small || history->first() == 0, history_name + ": the first steps are dropped");
+			Computer current = computer;
+			std::vector<int> changed_rows;
+			//Undo every step that can be reached
+			uint64_t first = history->first();
+			while (history->position() > first) {
+				//The large history keeps every record, so it knows the registers before each step
+				if (history == &large) {
+					std::string differences = differing_registers(history->previous(current.registers), states[size_t(history->position() - 1)].registers);
+					check(differences.empty(), history_name + ": previous differs at step " + std::to_string(history->position()) + " (" + differences + ")");
+				}
+				check(history->pop(current, changed_rows), history_name + ": pop fails");
+				check_state(current, states, history->position(), history_name + ": pop");
+			}
+			check(!history->pop(current, changed_rows), history_name + ": pop goes past the first step");
+
+			//Seek to random steps, and check that the changed rows are reported
+			//Restoring a checkpoint drops the records before it, so the first step is taken again before each seek
+			for (int seek = 0; seek < 100; seek++) {
+				first = history->first();
+				uint64_t step = first + random.next() % (history->end() - first + 1);
+				Computer old = current;
+				check(history->seek(current, step, changed_rows), history_name + ": seek fails");
+				check_state(current, states, step, history_name + ": seek");
+				for (int i = 0; i < 4096; i++)
+					if (old.memory[i] != current.memory[i] && std::find(changed_rows.begin(), changed_rows.end(), i) == changed_rows.end())
+						check(false, history_name + ": seek doesn't report the changed row " + std::to_string(i));
+			}
+			check(!history->seek(current, history->end() + 1, changed_rows), history_name + ": seek goes past the end");
+
+			//A new step after going back replaces the recorded future
+			uint64_t step = (history->first() + history->end()) / 2;
+			history->seek(current, step, changed_rows);
+			Registers before = current.registers;
+			current.step(data_change);
+			history->push(before, current.registers, data_change, current.memory);
+			check(history->end() == step + 1, history_name + ": a new step doesn't replace the future");
+			check(history->pop(current, changed_rows), history_name + ": pop fails after a new step");
+			check_state(current, states, step, history_name + ": pop after a new step");
+		}
+	}
+}
+
+//The fast interpreter executes every program the same way as Computer::step
+static void test_interpreter() {
+	Computer computer;
+	std::string error_text;
+	check(assemble_text(multiply_source, computer.memory, error_text), "multiply: " + error_text);
+	uint64_t steps;
+	check(computer.run(1000, 0, steps) == StopReason::Halt, "multiply: doesn't halt");
+	check(steps == 55, "multiply: " + std::to_string(steps) + " steps instead of 55");
+	check(computer.memory[8] == 143 && computer.registers.AC == 143, "multiply: the product isn't 143");
+	check(computer.registers.PC == 5, "multiply: the PC doesn't stay at HLT");
+
+	Random random(1);
+	for (int program = 0; program < RANDOM_PROGRAMS; program++) {
+		std::string name = "random program " + std::to_string(program);
+		Computer reference;
+		random_program(random, reference.memory);
+		random_registers(random, reference.registers);
+		Computer fast = reference, stopped = reference;
+
+		std::pair<int, uint16_t> data_change;
+		uint64_t reference_steps = 0;
+		bool reference_halt = false;
+		while (reference_steps < RANDOM_STEPS && !reference_halt) {
+			reference_halt = reference.step(data_change);
+			reference_steps++;
+		}
+
+		bool halt = false;
+		uint64_t fast_steps = fast.execute(RANDOM_STEPS, halt);
+		check(fast_steps == reference_steps && halt == reference_halt, name + ": execute stops at another step");
+		check_same(reference, fast, name + ": execute");
+
+		//Stopping after INP and OUT doesn't change the execution
+		halt = false;
+		uint64_t stopped_steps = 0;
+		while (stopped_steps < RANDOM_STEPS && !halt)
+			stopped_steps += stopped.execute(RANDOM_STEPS - stopped_steps, halt, true);
+		check(stopped_steps == reference_steps && halt == reference_halt, name + ": execute stops at another step after INP or OUT");
+		check_same(reference, stopped, name + ": execute after INP or OUT");
+	}
+}
+
+//The block cache executes every program the same way as Computer::step, also when a program changes its own code
+static void test_block_cache() {
+	//STA writes an INC over the CLA that comes next in the same block
+	std::vector<std::string> patch = {
+		"\tORG 0",
+		"\tLDA NEW",
+		"\tSTA PAT",
+		"PAT,\tCLA",
+		"\tHLT",
+		"NEW,\tINC",
+		"\tEND"
+	};
+	Computer computer;
+	std::string error_text;
+	check(assemble_text(patch, computer.memory, error_text), "patch: " + error_text);
+	BlockCache patched(computer);
+	bool halt = false;
+	uint64_t steps = patched.execute(100, halt);
+	check(halt && steps == 4, "patch: doesn't halt after 4 steps");
+	check(computer.registers.AC == 0x7021, "patch: the old instruction is executed");
+
+	Random random(5);
+	for (int program = 0; program < RANDOM_PROGRAMS; program++) {
+		std::string name = "random program " + std::to_string(program);
+		Computer reference;
+		random_program(random, reference.memory);
+		random_registers(random, reference.registers);
+		Computer cached = reference;
+
+		std::pair<int, uint16_t> data_change;
+		uint64_t reference_steps = 0;
+		bool reference_halt = false;
+		while (reference_steps < RANDOM_STEPS && !reference_halt) {
+			reference_halt = reference.step(data_change);
+			reference_steps++;
+		}
+
+		BlockCache cache(cached);
+		uint64_t cached_steps = cache.execute(RANDOM_STEPS, halt);
+		check(cached_steps == reference_steps && halt == reference_halt, name + ": BlockCache stops at another step");
+		check_same(reference, cached, name + ": BlockCache");
+	}
+}
+
+//Check that assembling a program fails with the given error
+static void check_error(const std::vector<std::string> &text, const std::string &expected) {
+	uint16_t memory[4096];
+	std::string error_text;
+	check(!assemble_text(text, memory, error_text) && error_text == expected,
+		"the error is \"" + error_text + "\" instead of \"" + expected + "\"");
+}
+
+//The assembler reports the right error for each mistake, and patches the references to the labels that come later
+static void test_assembler() {
+	uint16_t memory[4096];
+	std::string error_text;
+	//The forward references are patched at the end, the backward ones right away
+	std::vector<std::string> references = {
+		"\tORG 100",
+		"BGN,\tLDA FWD",
+		"\tBUN BGN I",
+		"\tSTA FWD I",
+		"FWD,\tHEX 1234",
+		"\tEND"
+	};
+	check(assemble_text(references, memory, error_text), "references: " + error_text);
+	check(memory[0x100] == 0x2103, "a forward reference isn't patched");
+	check(memory[0x101] == 0xC100, "a backward reference isn't resolved");
+	check(memory[0x102] == 0xB103, "an indirect forward reference isn't patched");
+	check(memory[0x103] == 0x1234, "HEX isn't assembled");
+
+	//A line that is written over by ORG keeps the later word, not a patched one
+	std::vector<std::string> overwritten = {
+		"\tORG 10",
+		"\tLDA LTR",
+		"\tORG 10",
+		"\tDEC -1",
+		"LTR,\tHEX 0",
+		"\tEND"
+	};
+	check(assemble_text(overwritten, memory, error_text), "overwritten: " + error_text);
+	check(memory[0x10] == 0xFFFF, "an overwritten word is patched");
+
+	check_error({"\tLDA XYZ", "\tEND"}, "Line 0: Label not defined.");
+	check_error({"A,\tHEX 1", "A,\tHEX 2", "\tEND"}, "Line 1: Label redefined.");
+	check_error({"\tCLA", "ABCD,\tCLA", "\tEND"}, "Line 1: Invalid label.");
+	check_error({"\tORG FFF", "\tCLA", "\tCLA", "\tEND"}, "Line 2: LC exceeded 4095.");
+	check_error({"\tHEX 10000", "\tEND"}, "Line 0: HEX number out of range.");
+	check_error({"\tDEC 32768", "\tEND"}, "Line 0: DEC number out of range.");
+	check_error({"\tLDA 123", "\tEND"}, "Line 0: The second part of an MRI must be a symbolic address.");
+	check_error({"\tCLAA", "\tEND"}, "Line 0: A non-MRI instruction must have 3 characters.");
+
+	//Empty and comment-only rows don't take a word, and a label must have a name
+	std::vector<std::string> rows = {
+		"\tORG 10",
+		"",
+		"/A comment",
+		"LBL,\tHEX 5",
+		"\tLDA LBL",
+		"\tEND"
+	};
+	check(assemble_text(rows, memory, error_text), "rows: " + error_text);
+	check(memory[0x10] == 5 && memory[0x11] == 0x2010, "an empty row takes a word");
+	check_error({",\tCLA", "\tEND"}, "Line 0: Invalid label.");
+}
+
+//The incremental assembler gives the same memory as assembling the whole source, and only reports the changed words
+static void test_incremental() {
+	std::vector<std::string> text = multiply_source;
+	IncrementalAssembler incremental(text.size());
+	for (size_t i = 0; i < text.size(); i++) {
+		SourceLine line;
+		parse_source_line(text[i], line);
+		incremental.set_line(i, line);
+	}
+	SymbolTable symbols;
+	std::string error_text;
+	std::vector<int> changed_words;
+	uint16_t memory[4096] = {}, expected[4096] = {};
+	check(incremental.assemble(memory, symbols, error_text, changed_words), "incremental: " + error_text);
+
+	//Each edit is assembled again, and the result is compared with a full assembly of the edited source
+	const std::pair<size_t, const char *> edits[] = {
+		{7, "A,\tDEC 7"},
+		{2, "\tADD CNT"},
+		{9, "RES,\tHEX FFFF"},
+		{1, "LOP,\tLDA A I"}
+	};
+	for (const std::pair<size_t, const char *> &edit : edits) {
+		std::string name = std::string("incremental edit \"") + edit.second + "\"";
+		text[edit.first] = edit.second;
+		SourceLine line;
+		parse_source_line(text[edit.first], line);
+		incremental.set_line(edit.first, line);
+		uint16_t old[4096];
+		std::memcpy(old, memory, sizeof(old));
+		changed_words.clear();
+		check(incremental.assemble(memory, symbols, error_text, changed_words), name + ": " + error_text);
+		check(assemble_text(text, expected, error_text), name + ": " + error_text);
+		check(std::memcmp(memory, expected, sizeof(memory)) == 0, name + ": the memory differs from a full assembly");
+		for (int i = 0; i < 4096; i++)
+			if (old[i] != memory[i] && std::find(changed_words.begin(), changed_words.end(), i) == changed_words.end())
+				check(false, name + ": the changed word " + std::to_string(i) + " isn't reported");
+	}
+
+	//An error leaves the memory as it was
+	SourceLine line;
+	parse_source_line("\tLDA XYZ", line);
+	incremental.set_line(3, line);
+	uint16_t old[4096];
+	std::memcpy(old, memory, sizeof(old));
+	check(!incremental.assemble(memory, symbols, error_text, changed_words) && error_text == "Line 3: Label not defined.", "incremental error: the error is \"" + error_text + "\"");
+	check(std::memcmp(memory, old, sizeof(memory)) == 0, "incremental error: the memory is changed");
+}
+
+//Check that the lockstep engines give the same results as running each input on its own
+static void check_lockstep(const BatchProgram &program, const std::vector<BatchInput> &inputs, uint64_t max_steps, const std::string &name) {
+	std::vector<BatchResult> results = run_lockstep(program, 0, inputs, max_steps, 2);
+	check(results.size() == inputs.size(), name + ": a result is missing");
+	for (size_t i = 0; i < inputs.size() && i < results.size(); i++) {
+		Computer computer;
+		std::memcpy(computer.memory, program.memory, sizeof(computer.memory));
+		BatchResult expected;
+		run_with_input(computer, inputs[i].bytes, max_steps, expected);
+		const BatchResult &result = results[i];
+		std::string lane = name + ", input " + std::to_string(i);
+		check(result.reason == expected.reason && result.steps == expected.steps, lane + ": stops at another step");
+		check(result.output == expected.output, lane + ": the output differs");
+		std::string differences = differing_registers(result.registers, expected.registers);
+		check(differences.empty(), lane + ": the registers differ (" + differences + ")");
+	}
+}
+
+//A lockstep run gives the same result for each input as run_with_input
+static void test_lockstep() {
+	BatchProgram echo;
+	std::string error_text;
+	check(assemble_text(echo_source, echo.memory, error_text), "echo: " + error_text);
+	BatchInput mano = {"mano", {'M', 'a', 'n', 'o', 0}};
+	std::vector<BatchResult> results = run_lockstep(echo, 0, {mano}, 10000, 1);
+	check(results.size() == 1 && results[0].reason == StopReason::Halt, "echo: doesn't halt");
+	check(results.size() == 1 && results[0].output == mano.bytes, "echo: doesn't echo its input");
+
+	//More inputs than lanes, of different lengths, so that the lanes halt at different steps
+	Random random(2);
+	std::vector<BatchInput> inputs(LOCKSTEP_LANES * 2 + 3);
+	for (size_t i = 0; i < inputs.size(); i++) {
+		inputs[i].name = std::to_string(i);
+		size_t length = random.next() % 40;
+		for (size_t j = 0; j < length; j++)
+			inputs[i].bytes.push_back(uint8_t(1 + random.next() % 255));
+		inputs[i].bytes.push_back(0);
+	}
+	check_lockstep(echo, inputs, 100000, "echo");
+
+	//Random programs diverge on almost every step, so the lanes are regrouped all the time
+	for (int program = 0; program < RANDOM_PROGRAMS / 5; program++) {
+		BatchProgram random_batch;
+		random_program(random, random_batch.memory);
+		check_lockstep(random_batch, inputs, RANDOM_STEPS, "random program " + std::to_string(program));
+	}
+}
+
+//The profiler counts the steps of each address, operation and call stack, and the back-edges of the loops
+static void test_profiler() {
+	//The subroutine is called three times, the loop is closed twice before ISZ skips to HLT
+	std::vector<std::string> calls = {
+		"\tORG 0",
+		"LOP,\tBSA SUB",
+		"\tISZ CNT",
+		"\tBUN LOP",
+		"\tHLT",
+		"CNT,\tDEC -3",
+		"SUB,\tHEX 0",
+		"\tINC",
+		"\tBUN SUB I",
+		"\tEND"
+	};
+	Computer computer;
+	SymbolTable symbols;
+	std::string error_text;
+	check(assemble_text(calls, computer.memory, symbols, error_text), "calls: " + error_text);
+	Profiler profiler;
+	profiler.start(computer);
+	uint64_t steps;
+	check(computer.run(1000, 0, steps, [&](const std::pair<int, uint16_t> &, bool) {profiler.record(computer);}) == StopReason::Halt, "calls: doesn't halt");
+	check(steps == 15 && profiler.steps() == 15, "calls: " + std::to_string(profiler.steps()) + " steps are recorded instead of 15");
+	check(profiler.address_count(0) == 3 && profiler.address_count(6) == 3 && profiler.address_count(2) == 2, "calls: the steps of an address are wrong");
+	check(profiler.operation_count(OP_BSA) == 3 && profiler.operation_count(OP_BUN_I) == 3, "calls: the steps of an operation are wrong");
+	check(profiler.interrupts() == 0, "calls: an interrupt is recorded");
+
+	//Only the BUN of the loop jumps backwards, the returns are not loops
+	std::vector<BackEdge> back_edges = profiler.back_edges();
+	check(back_edges.size() == 1 && back_edges[0].from == 2 && back_edges[0].to == 0 && back_edges[0].count == 2, "calls: the back-edges are wrong");
+
+	//The call takes its BSA in the caller, and the subroutine its INC and return
+	std::ostringstream collapsed;
+	profiler.write_collapsed(collapsed, symbols);
+	check(collapsed.str() == "main 9\nmain;SUB 6\n", "calls: the call stacks are \"" + collapsed.str() + "\"");
+}
+
+//The control unit takes the clock cycles of the timing signals, and completes every instruction the same way as
+//Computer::step
+static void test_control_unit() {
+	//LDA, ADD 6 cycles, STA, BUN 5, ISZ 7 and HLT 4
+	Computer computer;
+	std::string error_text;
+	check(assemble_text(multiply_source, computer.memory, error_text), "multiply: " + error_text);
+	ControlUnit control_unit(computer);
+	uint64_t steps;
+	check(control_unit.run(1000, 0, steps) == StopReason::Halt && steps == 55, "multiply: doesn't halt after 55 steps");
+	check(computer.memory[8] == 143, "multiply: the product isn't 143");
+	check(control_unit.cycles() == 318 && control_unit.instructions() == 55, "multiply: " + std::to_string(control_unit.cycles()) + " cycles instead of 318");
+	check(control_unit.operation_cycles(OP_ISZ) == 11 * 7 && control_unit.operation_count(OP_BUN) == 10, "multiply: the cycles of an operation are wrong");
+
+	//Aborting an instruction in the middle undoes its clock cycles
+	Computer started = computer;
+	started.registers.PC = 2;
+	started.memory[8] = 0;
+	Computer aborted = started;
+	ControlUnit partial(aborted);
+	bool halt;
+	check(!partial.tick(halt) && !partial.tick(halt) && !partial.tick(halt) && !partial.tick(halt), "abort: STA is completed too soon");
+	partial.abort();
+	check(partial.timing_signal() == 0, "abort: the sequence counter isn't cleared");
+	check_same(started, aborted, "abort");
+
+	Random random(6);
+	for (int program = 0; program < RANDOM_PROGRAMS; program++) {
+		std::string name = "random program " + std::to_string(program);
+		Computer reference;
+		random_program(random, reference.memory);
+		random_registers(random, reference.registers);
+		Computer clocked = reference;
+		ControlUnit clocked_unit(clocked);
+
+		std::pair<int, uint16_t> reference_change, clocked_change;
+		uint64_t step = 0;
+		halt = false;
+		while (step < RANDOM_STEPS && !halt) {
+			halt = reference.step(reference_change);
+			bool clocked_halt = clocked_unit.step(clocked_change);
+			check(clocked_halt == halt && clocked_change == reference_change, name + ": ControlUnit differs at step " + std::to_string(step));
+			step++;
+		}
+		check_same(reference, clocked, name + ": ControlUnit");
+	}
+}
+
+//Write the bytes of a file
+static void write_file(const char *address, const std::string &bytes) {
+	std::ofstream file(address, std::ios::binary);
+	file.write(bytes.data(), std::streamsize(bytes.size()));
+}
+
+//Check that loading a memory image fails with the given error, and doesn't change anything
+static void check_image_error(const char *address, const std::string &expected, const std::string &name) {
+	Computer computer;
+	for (int i = 0; i < 4096; i++)
+		computer.memory[i] = 0x5555;
+	computer.registers.AC = 0x1234;
+	Computer old = computer;
+	SymbolTable symbols;
+	symbols.insert(SymbolTable::pack("OLD", 3), 7);
+	int source_map[4096];
+	std::fill(source_map, source_map + 4096, 3);
+	std::string error_text;
+	check(!load_image(address, computer, symbols, source_map, error_text) && error_text == expected, name + ": the error is \"" + error_text + "\" instead of \"" + expected + "\"");
+	check_same(old, computer, name);
+	check(symbols.size() == 1 && symbols.find(SymbolTable::pack("OLD", 3)) == 7, name + ": the symbols are changed");
+	check(std::count(source_map, source_map + 4096, 3) == 4096, name + ": the source map is changed");
+}
+
+//A memory image gives back the saved state, symbols and source map, and a damaged image is rejected
+static void test_image() {
+	const char *address = "ManoTests.mano";
+	Computer computer;
+	SymbolTable symbols;
+	int source_map[4096];
+	std::string error_text;
+	check(assemble_text(multiply_source, computer.memory, symbols, error_text, source_map), "multiply: " + error_text);
+	uint64_t steps;
+	computer.run(7, 0, steps);
+	computer.registers.IEN = true;
+	computer.registers.INPR = 0x41;
+	check(save_image(address, computer, symbols, source_map, error_text), "save: " + error_text);
+
+	Computer loaded;
+	SymbolTable loaded_symbols;
+	int loaded_map[4096];
+	check(load_image(address, loaded, loaded_symbols, loaded_map, error_text), "load: " + error_text);
+	check_same(computer, loaded, "load");
+	check(loaded_symbols.size() == symbols.size() && loaded_symbols.find(SymbolTable::pack("RES", 3)) == 8, "load: the symbols differ");
+	check(std::equal(source_map, source_map + 4096, loaded_map), "load: the source map differs");
+
+	//Every kind of damage is found before anything is changed
+	std::ifstream file(address, std::ios::binary);
+	std::string image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	const size_t pc = 16 + 6, flags = 16 + 14, symbol_addresses = 16 + 24 + 4096 * 2 + 4096 * 4 + 4;
+	std::string damaged = image;
+	damaged.resize(image.size() - 1);
+	write_file(address, damaged);
+	check_image_error(address, "The memory image is damaged.", "truncated image");
+	write_file(address, image.substr(0, 100));
+	check_image_error(address, "The file isn't a memory image.", "short image");
+	write_file(address, "ORG 0\nHLT\nEND\n");
+	check_image_error(address, "The file isn't a memory image.", "source file");
+	damaged = image;
+	damaged[4] = 2;
+	write_file(address, damaged);
+	check_image_error(address, "The memory image has an unsupported version.", "version 2");
+	damaged = image;
+	damaged[pc + 1] = 0x10;
+	write_file(address, damaged);
+	check_image_error(address, "The memory image is damaged.", "PC out of range");
+	damaged = image;
+	damaged[flags] = 2;
+	write_file(address, damaged);
+	check_image_error(address, "The memory image is damaged.", "flag out of range");
+	damaged = image;
+	damaged[symbol_addresses + 1] = 0x10;
+	write_file(address, damaged);
+	check_image_error(address, "The memory image is damaged.", "symbol out of range");
+	std::remove(address);
+	check_image_error(address, "Failed to load file.", "missing image");
+}
+
+//The parser that split each line before the single-pass one, the single-pass parser must give the same sections
+static bool reference_parse(std::string tmp, SourceLine &result) {
+	if (tmp.empty())
+		return false;
+	if (tmp.find('/') != std::string::npos) {
+		result.comment = tmp.substr(tmp.find('/'));
+		tmp.erase(tmp.find('/'), std::string::npos);
+	}
+	else
+		result.comment = "";
+	std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::toupper);
+	size_t i = 0;
+	while (i < tmp.size()) {
+		if (i + 1 < tmp.size() && tmp[i] == ' ' && tmp[i + 1] == ' ')
+			tmp.erase(i, 1);
+		else if (('0' > tmp[i] || tmp[i] > '9') && ('A' > tmp[i] || tmp[i] > 'Z') && tmp[i] != ',' && tmp[i] != ' ' && tmp[i] != '-')
+			tmp.erase(i, 1);
+		else
+			i++;
+	}
+	if (tmp.find(',') != std::string::npos) {
+		result.label = tmp.substr(0, tmp.find(',') + 1);
+		tmp.erase(0, tmp.find(',') + 1);
+	}
+	else
+		result.label = "";
+	result.instruction = tmp;
+	return true;
+}
+
+//The source reader gives every line of a file, however long, without its line break, and the parser splits the lines
+//the same way as before
+static void test_source_reader() {
+	const char *address = "ManoTests.txt";
+	Random random(7);
+	//Random files with lines longer than the buffer of the reader, CRLF and LF line breaks and a last line with or
+	//without a line break
+	for (int round = 0; round < 20; round++) {
+		std::string name = "file " + std::to_string(round);
+		std::vector<std::string> lines(1 + random.next() % 40);
+		std::string file;
+		for (size_t i = 0; i < lines.size(); i++) {
+			size_t length = random.next() % 100;
+			if (random.next() % 8 == 0)
+				length = 60 * 1024 + random.next() % (100 * 1024);
+			for (size_t j = 0; j < length; j++)
+				lines[i].push_back(char('A' + random.next() % 26));
+			file += lines[i];
+			if (i + 1 < lines.size() || random.next() % 2 == 0)
+				file += (random.next() % 2 == 0 ? "\r\n" : "\n");
+		}
+		write_file(address, file);
+		SourceReader reader(address);
+		check(reader.is_open(), name + ": isn't opened");
+		const char *line;
+		size_t length;
+		size_t count = 0;
+		while (reader.next(line, length)) {
+			check(count < lines.size() && std::string(line, length) == lines[count], name + ": line " + std::to_string(count) + " differs");
+			count++;
+		}
+		//A file that ends with an empty line can't be told apart from one that ends with a line break
+		check(count == lines.size() || (count + 1 == lines.size() && lines.back().empty()), name + ": " + std::to_string(count) + " lines instead of " + std::to_string(lines.size()));
+	}
+
+	//Random lines of the characters that the parser treats differently
+	const char characters[] = "aZ09 ,-/\t\r#lL";
+	for (int round = 0; round < 100000; round++) {
+		std::string line;
+		size_t length = random.next() % 24;
+		for (size_t i = 0; i < length; i++)
+			line.push_back(characters[random.next() % (sizeof(characters) - 1)]);
+		SourceLine result, expected;
+		bool parsed = parse_source_line(line, result);
+		check(parsed == reference_parse(line, expected), "\"" + line + "\": isn't parsed the same way");
+		if (parsed)
+			check(result.label == expected.label && result.instruction == expected.instruction && result.comment == expected.comment, "\"" + line + "\": the sections differ");
+	}
+
+	//The empty lines are skipped, and a file with too many lines is rejected
+	write_file(address, "LOP,\tlda x / Loop\r\n\r\n\n\tHLT\r\nX,\tDEC 5\r\n\tEND");
+	std::vector<SourceLine> lines;
+	std::string error_text;
+	check(load_source_file(address, lines, error_text), "load: " + error_text);
+	check(lines.size() == 4 && lines[0].label == "LOP," && lines[0].instruction == "LDA X " && lines[0].comment == "/ Loop" && lines[3].instruction == "END", "load: the lines are wrong");
+	check(!load_source_file(address, lines, error_text, 3) && error_text == "The file contains more than 3 lines.", "too long: the error is \"" + error_text + "\"");
+	std::remove(address);
+	check(!load_source_file(address, lines, error_text) && error_text == "Failed to load file.", "missing file: the error is \"" + error_text + "\"");
+}
+
+//Add two words in a loop that runs three times, the first word is read through a pointer
+static const std::vector<std::string> pointer_source = {
+	"\tORG 0",
+	"LOP,\tLDA PTR I",
+	"\tADD ONE",
+	"\tSTA SUM",
+	"\tISZ CNT",
+	"\tBUN LOP",
+	"\tHLT",
+	"PTR,\tHEX 9",
+	"ONE,\tDEC 1",
+	"SUM,\tDEC 0",
+	"VAL,\tDEC 41",
+	"CNT,\tDEC -3",
+	"\tEND"
+};
+
+//Check that a run with the given breakpoints stops for the given reason after the given number of steps
+static void check_run(Computer &computer, const Breakpoints &breakpoints, StopReason reason, uint64_t expected_steps, const std::string &name) {
+	uint64_t steps;
+	check(computer.run_with_breakpoints(1000, 0, steps, breakpoints) == reason && steps == expected_steps,
+		name + ": stops after " + std::to_string(steps) + " steps instead of " + std::to_string(expected_steps));
+}
+
+//Check the watched word that a step reports, after the given number of steps from the start of the program
+static void check_watched(const Computer &start, const Breakpoints &breakpoints, int step_count, bool interrupt, int expected, const std::string &name) {
+	Computer computer = start;
+	std::pair<int, uint16_t> data_change;
+	for (int i = 1; i < step_count; i++)
+		computer.step(data_change);
+	computer.registers.R = interrupt;
+	computer.step(data_change);
+	int watched = computer.watched_address(interrupt, data_change, breakpoints);
+	check(watched == expected, name + ": the watched word is " + std::to_string(watched) + " instead of " + std::to_string(expected));
+}
+
+//The execute breakpoints stop before their instruction, except when a run starts at it, and the watchpoints stop after
+//an access to their word
+static void test_breakpoints() {
+	Computer start;
+	std::string error_text;
+	check(assemble_text(pointer_source, start.memory, error_text), "pointer: " + error_text);
+	Computer computer = start;
+	Breakpoints breakpoints;
+	check_run(computer, breakpoints, StopReason::Halt, 15, "no breakpoints");
+	check(computer.memory[8] == 42, "no breakpoints: the sum isn't 42");
+
+	//A run that continues from a breakpoint doesn't stop at it right away
+	breakpoints.set(BREAK_EXECUTE, 2, true);
+	computer = start;
+	check_run(computer, breakpoints, StopReason::Breakpoint, 2, "execute STA");
+	check(computer.registers.PC == 2 && computer.memory[8] == 0, "execute STA: STA is executed");
+	check_run(computer, breakpoints, StopReason::Breakpoint, 5, "execute STA in the second loop");
+	check_run(computer, breakpoints, StopReason::Breakpoint, 5, "execute STA in the third loop");
+	check_run(computer, breakpoints, StopReason::Halt, 3, "execute STA to the end");
+	breakpoints.set(BREAK_EXECUTE, 2, false);
+	breakpoints.set(BREAK_EXECUTE, 5, true);
+	computer = start;
+	check_run(computer, breakpoints, StopReason::Breakpoint, 14, "execute HLT");
+	check_run(computer, breakpoints, StopReason::Halt, 1, "execute HLT to the end");
+	breakpoints.clear();
+	check(breakpoints.empty(), "clear: a breakpoint is left");
+
+	//A word that is never read doesn't stop the run, one that is written does
+	breakpoints.set(BREAK_READ, 8, true);
+	computer = start;
+	check_run(computer, breakpoints, StopReason::Halt, 15, "read SUM");
+	breakpoints.set(BREAK_WRITE, 10, true);
+	computer = start;
+	check_run(computer, breakpoints, StopReason::Breakpoint, 4, "write CNT");
+	breakpoints.clear();
+
+	//An indirect instruction reads its pointer and the word that it points to, ISZ reads and writes its word, and the
+	//interrupt cycle writes the return address to word 0
+	breakpoints.set(BREAK_READ, 9, true);
+	check_watched(start, breakpoints, 1, false, 9, "read through the pointer");
+	breakpoints.set(BREAK_READ, 9, false);
+	breakpoints.set(BREAK_READ, 6, true);
+	check_watched(start, breakpoints, 1, false, 6, "read the pointer");
+	breakpoints.set(BREAK_READ, 6, false);
+	breakpoints.set(BREAK_READ, 7, true);
+	check_watched(start, breakpoints, 1, false, -1, "read ONE before ADD");
+	check_watched(start, breakpoints, 2, false, 7, "read ONE");
+	breakpoints.set(BREAK_READ, 7, false);
+	breakpoints.set(BREAK_READ, 8, true);
+	check_watched(start, breakpoints, 3, false, -1, "read SUM with STA");
+	breakpoints.set(BREAK_READ, 8, false);
+	breakpoints.set(BREAK_WRITE, 8, true);
+	check_watched(start, breakpoints, 3, false, 8, "write SUM");
+	breakpoints.set(BREAK_WRITE, 8, false);
+	breakpoints.set(BREAK_READ, 10, true);
+	check_watched(start, breakpoints, 4, false, 10, "read CNT with ISZ");
+	breakpoints.set(BREAK_READ, 10, false);
+	breakpoints.set(BREAK_WRITE, 10, true);
+	check_watched(start, breakpoints, 4, false, 10, "write CNT with ISZ");
+	breakpoints.set(BREAK_WRITE, 10, false);
+	breakpoints.set(BREAK_WRITE, 0, true);
+	check_watched(start, breakpoints, 1, true, 0, "interrupt cycle");
+	check(breakpoints.count(BREAK_WRITE) == 1 && breakpoints.count(BREAK_READ) == 0, "the breakpoints aren't counted");
+}
+
+//Check that compiling a condition fails with the given error
+static void check_condition_error(const std::string &text, const std::string &expected) {
+	Condition condition;
+	std::string error_text;
+	check(!condition.compile(text, error_text) && error_text == expected,
+		"\"" + text + "\": the error is \"" + error_text + "\" instead of \"" + expected + "\"");
+}
+
+//The conditions are evaluated like C expressions on signed words, and the mistakes are reported
+static void test_condition() {
+	Registers before = {}, after = {};
+	after.PC = 0x120;
+	after.AC = 0xFFFF;
+	after.IR = 0x7001;
+	after.E = true;
+	uint16_t memory[4096] = {};
+	memory[0x10] = 5;
+	const std::pair<const char *, bool> conditions[] = {
+		{"PC == 0x120 && AC < 0", true},
+		{"E != old(E) && IEN == 1", false},
+		{"E != old(E) || IEN == 1", true},
+		{"IR & 0xF000 == 0x7000", true},
+		{"M[0x10] + 1 == 6", true},
+		{"M[PC - 0x110] == 5", true},
+		{"-AC == 1", true},
+		{"!(AC + 1)", true},
+		{"~AC == 0", true},
+		{"old(PC) >= PC", false}
+	};
+	for (const std::pair<const char *, bool> &expected : conditions) {
+		Condition condition;
+		std::string error_text;
+		check(condition.compile(expected.first, error_text), std::string(expected.first) + ": " + error_text);
+		check(condition.evaluate(before, after, memory) == expected.second, std::string(expected.first) + ": the result is wrong");
+	}
+
+	check_condition_error("PC ==", "Unexpected end of the condition.");
+	check_condition_error("PC == 1 )", "Unexpected \")\" in the condition.");
+	check_condition_error("FOO == 1", "Unknown register \"FOO\" in the condition.");
+	check_condition_error("AC == 0x10000", "The number 0x10000 doesn't fit in a word.");
+	check_condition_error("(AC == 1", "Unexpected end of the condition.");
+	check_condition_error("M[AC == 1", "Unexpected end of the condition.");
+	check_condition_error("M[AC) == 1", "Expected \"]\" in the condition.");
+	check_condition_error("AC == 0x", "Expected a hexadecimal number in the condition.");
+	//Too deep a stack, and too deep a nesting of parentheses
+	std::string deep = "1";
+	for (int i = 0; i < CONDITION_MAX_DEPTH; i++)
+		deep = "1 + (" + deep + ")";
+	check_condition_error(deep, "The condition is too complex.");
+	check_condition_error(std::string(100, '(') + "1" + std::string(100, ')'), "The condition is too complex.");
+
+	//A run stops after the step that has made a condition true, the first STA of a sum above 0x40
+	Computer computer;
+	std::string error_text;
+	check(assemble_text(multiply_source, computer.memory, error_text), "multiply: " + error_text);
+	Condition never, sum;
+	check(never.compile("AC == 0x7FFF", error_text) && sum.compile("M[8] > 0x40 && old(PC) == 2", error_text), "conditions: " + error_text);
+	Breakpoints breakpoints;
+	breakpoints.add_condition(never);
+	breakpoints.add_condition(sum);
+	//The registers before the last step tell which condition is true
+	Registers previous = computer.registers, last = previous;
+	uint64_t steps;
+	StopReason reason = computer.run_with_breakpoints(1000, 0, steps, breakpoints, [&](const std::pair<int, uint16_t> &, bool) {
+		previous = last;
+		last = computer.registers;
+	});
+	check(reason == StopReason::Breakpoint && steps == 23, "condition: stops after " + std::to_string(steps) + " steps instead of 23");
+	check(computer.memory[8] == 65, "condition: the sum is " + std::to_string(computer.memory[8]) + " instead of 65");
+	check(breakpoints.true_condition(previous, computer.registers, computer.memory) == 1, "condition: another condition is true");
+}
+
+//A trace holds every step and input of a run, and a damaged trace is reported
+static void test_trace() {
+	const char *address = "ManoTests.trace";
+	Random random(4);
+	Computer computer;
+	random_program(random, computer.memory);
+	random_registers(random, computer.registers);
+	TraceWriter writer;
+	std::string error_text;
+	check(writer.open(address, computer, error_text), "trace: " + error_text);
+
+	//The state after each step
+	std::vector<Computer> states;
+	std::pair<int, uint16_t> data_change;
+	uint64_t inputs = 0;
+	for (int step = 0; step < RANDOM_STEPS; step++) {
+		//Now and then a new input is given between two steps
+		if (random.next() % 8 == 0) {
+			computer.registers.INPR = uint8_t(random.next());
+			computer.registers.FGI = true;
+			inputs++;
+		}
+		Registers before = computer.registers;
+		computer.step(data_change);
+		writer.record(before, data_change, computer);
+		states.push_back(computer);
+	}
+	check(writer.close(error_text), "trace: " + error_text);
+	check(writer.steps() == RANDOM_STEPS, "trace: the steps aren't counted");
+
+	TraceReader reader;
+	check(reader.open(address, error_text), "trace: " + error_text);
+	TraceRecord record;
+	uint64_t records = 0;
+	while (reader.next(record)) {
+		records++;
+		if (!record.step)
+			continue;
+		const Computer &expected = states[size_t(reader.steps() - 1)];
+		std::string differences = differing_registers(reader.registers(), expected.registers);
+		check(differences.empty(), "trace: the registers differ at step " + std::to_string(reader.steps()) + " (" + differences + ")");
+		check(std::memcmp(reader.memory(), expected.memory, sizeof(expected.memory)) == 0, "trace: the memory differs at step " + std::to_string(reader.steps()));
+	}
+	check(reader.error_text().empty(), "trace: " + reader.error_text());
+	check(reader.steps() == RANDOM_STEPS, "trace: a step is missing");
+	check(records <= RANDOM_STEPS + inputs, "trace: an input is recorded more than once");
+
+	//A trace that ends in the middle of a record is damaged
+	std::FILE *file = std::fopen(address, "ab");
+	std::fputc(0x80, file);
+	std::fclose(file);
+	TraceReader damaged;
+	check(damaged.open(address, error_text), "damaged trace: " + error_text);
+	while (damaged.next(record)) {}
+	check(damaged.error_text() == "The trace is damaged after " + std::to_string(RANDOM_STEPS) + " steps.", "damaged trace: the error is \"" + damaged.error_text() + "\"");
+
+	//A file that doesn't start with the trace header isn't read
+	file = std::fopen(address, "wb");
+	std::fputs("ORG 0\nHLT\nEND\n", file);
+	std::fclose(file);
+	TraceReader other;
+	check(!other.open(address, error_text) && error_text == "The file isn't a trace.", "not a trace: the error is \"" + error_text + "\"");
+	std::remove(address);
+}
+
+//The input device gives the pushed bytes and then the bytes of its file, the output device keeps the bytes or writes
+//them to its file, and attached devices serve a program that echoes its input
+static void test_devices() {
+	const char *address = "ManoTests.bin";
+	std::string error_text;
+	InputDevice input;
+	const uint8_t pushed[] = {'a', 'b'};
+	input.push(pushed, 2);
+	write_file(address, "cd");
+	check(input.open(address, error_text), "input: " + error_text);
+	std::string bytes;
+	uint8_t byte;
+	while (input.next(byte))
+		bytes.push_back(char(byte));
+	check(bytes == "abcd" && input.count() == 4, "input: gives \"" + bytes + "\" instead of \"abcd\"");
+	input.clear();
+	check(!input.next(byte), "input: a byte is left after clear");
+	std::remove(address);
+	check(!input.open(address, error_text) && error_text == "Failed to load the input file.", "missing input: the error is \"" + error_text + "\"");
+
+	OutputDevice output;
+	output.write('x');
+	output.write('y');
+	check(output.bytes().size() == 2 && output.count() == 2, "output: the bytes aren't kept");
+	std::string out;
+	output.take(out);
+	check(out == "xy" && output.bytes().empty(), "output: take gives \"" + out + "\" instead of \"xy\"");
+	check(output.open(address, error_text), "output: " + error_text);
+	output.write('z');
+	check(output.close(error_text), "output: " + error_text);
+	std::ifstream file(address, std::ios::binary);
+	std::string written((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	check(written == "z" && output.bytes().empty() && output.count() == 3, "output: the file has \"" + written + "\" instead of \"z\"");
+	std::remove(address);
+
+	//The echo program reads the bytes in its interrupt service routine until the 0 byte
+	Computer computer;
+	check(assemble_text(echo_source, computer.memory, error_text), "echo: " + error_text);
+	IODevices devices;
+	const uint8_t mano[] = {'M', 'a', 'n', 'o', 0};
+	devices.input.push(mano, sizeof(mano));
+	devices.attach(computer.registers);
+	uint64_t steps;
+	check(computer.run(10000, 0, steps, [&](const std::pair<int, uint16_t> &, bool) {devices.serve(computer.registers);}) == StopReason::Halt, "echo: doesn't halt");
+	check(devices.output.bytes() == std::vector<uint8_t>(mano, mano + sizeof(mano)) && devices.input.count() == sizeof(mano), "echo: doesn't echo its input");
+}
+
+//A test of the simulator core, run by name
+struct Test {
+	const char *name;
+	void (*run)();
+};
+
+static const Test tests[] = {
+	{"history", test_history},
+	{"interpreter", test_interpreter},
+	{"block_cache", test_block_cache},
+	{"assembler", test_assembler},
+	{"incremental", test_incremental},
+	{"lockstep", test_lockstep},
+	{"profiler", test_profiler},
+	{"control_unit", test_control_unit},
+	{"image", test_image},
+	{"source_reader", test_source_reader},
+	{"breakpoints", test_breakpoints},
+	{"condition", test_condition},
+	{"trace", test_trace},
+	{"devices", test_devices}
+};
+
+int main(int argc, char *argv[]) {
+	bool found = false;
+	for (const Test &test : tests)
+		if (argc < 2 || std::string(argv[1]) == test.name) {
+			test.run();
+			found = true;
+		}
+	if (!found) {
+		fprintf(stderr, "Usage: %s [test]\nThe tests are:", argv[0]);
+		for (const Test &test : tests)
+			fprintf(stderr, " %s", test.name);
+		fprintf(stderr, "\n");
+		return 1;
+	}
+	if (failures != 0) {
+		fprintf(stderr, "%d checks failed.\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,174 @@
+#include "Computer.h"
+#include "Trace.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+//Print the usage of the trace tool
+static void print_usage(const char *program) {
+	fprintf(stderr, "Usage: %s dump <run.trace> [first [count]]\n", program);
+	fprintf(stderr, "       %s replay <run.trace>\n", program);
+	fprintf(stderr, "       %s diff <a.trace> <b.trace>\n", program);
+	fprintf(stderr, "Reads the traces that ManoCLI -t records.\n");
+	fprintf(stderr, "  dump    Print the steps of the trace (from the step first, at most count steps)\n");
+	fprintf(stderr, "  replay  Execute the program again from the state that the trace starts from, feeding it the recorded inputs,\n");
+	fprintf(stderr, "          and check that every step matches the trace\n");
+	fprintf(stderr, "  diff    Find the first step where two traces differ\n");
+}
+
+//Print the main registers of a state
+static void print_state(const char *name, const Registers &registers) {
+	printf("%s PC %03X IR %04X AC %04X DR %04X AR %03X E %d R %d IEN %d FGI %d FGO %d INPR %02X OUTR %02X\n", name, registers.PC,
+		registers.IR, registers.AC, registers.DR, registers.AR, int(registers.E), int(registers.R), int(registers.IEN),
+		int(registers.FGI), int(registers.FGO), registers.INPR, registers.OUTR);
+}
+
+//Print a record, given the state before it
+static void print_record(uint64_t step, const Registers &before, const TraceRecord &record) {
+	const Registers &registers = record.registers;
+	if (!record.step) {
+		printf("%10s input %s: INPR %02X FGI %d FGO %d IEN %d\n", "", register_differences(before, registers).c_str(), registers.INPR,
+			int(registers.FGI), int(registers.FGO), int(registers.IEN));
+		return;
+	}
+	//The interrupt cycle doesn't execute the instruction at the PC
+	if (before.R)
+		printf("%10llu interrupt  ", (unsigned long long)step);
+	else
+		printf("%10llu %03X %04X  ", (unsigned long long)step, before.PC, registers.IR);
+	printf("AC %04X E %d", registers.AC, int(registers.E));
+	if (record.address != -1)
+		printf("  M[%03X] <- %04X", record.address, record.value);
+	printf("\n");
+}
+
+static int dump(const std::string &address, uint64_t first, uint64_t count) {
+	TraceReader reader;
+	std::string error_text;
+	if (!reader.open(address, error_text)) {
+		fprintf(stderr, "%s\n", error_text.c_str());
+		return 1;
+	}
+	print_state("Start:", reader.registers());
+	TraceRecord record;
+	Registers before = reader.registers();
+	while (reader.next(record)) {
+		//A step is numbered from 1, and an input is shown with the step after it
+		uint64_t step = reader.steps() + (record.step ? 0 : 1);
+		if (step >= first + count && count != 0)
+			break;
+		if (step >= first)
+			print_record(reader.steps(), before, record);
+		before = record.registers;
+	}
+	if (!reader.error_text().empty()) {
+		fprintf(stderr, "%s\n", reader.error_text().c_str());
+		return 1;
+	}
+	return 0;
+}
+
+static int replay(const std::string &address) {
+	TraceReader reader;
+	std::string error_text;
+	if (!reader.open(address, error_text)) {
+		fprintf(stderr, "%s\n", error_text.c_str());
+		return 1;
+	}
+	Computer computer;
+	computer.registers = reader.registers();
+	std::memcpy(computer.memory, reader.memory(), sizeof(computer.memory));
+
+	TraceRecord record;
+	std::pair<int, uint16_t> data_change;
+	while (reader.next(record)) {
+		if (!record.step) {
+			computer.registers = record.registers;
+			continue;
+		}
+		computer.step(data_change);
+		std::string differences = register_differences(computer.registers, record.registers);
+		int address = (record.address != -1 ? record.address : data_change.first);
+		uint16_t expected = (record.address != -1 ? record.value : data_change.second);
+		if (!differences.empty() || computer.memory[address] != expected) {
+			printf("The replay differs from the trace at step %llu:", (unsigned long long)reader.steps());
+			if (!differences.empty())
+				printf(" %s", differences.c_str());
+			if (computer.memory[address] != expected)
+				printf(" M[%03X]", address);
+			printf("\n");
+			print_state("Trace: ", record.registers);
+			print_state("Replay:", computer.registers);
+			return 1;
+		}
+	}
+	if (!reader.error_text().empty()) {
+		fprintf(stderr, "%s\n", reader.error_text().c_str());
+		return 1;
+	}
+	printf("Replayed %llu steps, the program matches the trace.\n", (unsigned long long)reader.steps());
+	return 0;
+}
+
+static int diff(const std::string &address_a, const std::string &address_b) {
+	TraceReader a, b;
+	std::string error_text;
+	if (!a.open(address_a, error_text) || !b.open(address_b, error_text)) {
+		fprintf(stderr, "%s\n", error_text.c_str());
+		return 1;
+	}
+	//The records only hold the changes, so the traces are compared from the same start
+	std::string differences = register_differences(a.registers(), b.registers());
+	if (!differences.empty()) {
+		printf("The traces start from different registers: %s\n", differences.c_str());
+		return 1;
+	}
+	for (int i = 0; i < 4096; i++)
+		if (a.memory()[i] != b.memory()[i]) {
+			printf("The traces start from different memories, the first difference is at %03X.\n", i);
+			return 1;
+		}
+
+	TraceRecord record_a, record_b;
+	Registers before = a.registers();
+	while (true) {
+		bool more_a = a.next(record_a), more_b = b.next(record_b);
+		if (!a.error_text().empty() || !b.error_text().empty()) {
+			fprintf(stderr, "%s\n", (!a.error_text().empty() ? a.error_text() : b.error_text()).c_str());
+			return 1;
+		}
+		if (!more_a && !more_b)
+			break;
+		if (!more_a || !more_b) {
+			printf("%s ends after %llu steps, %s continues.\n", (more_a ? address_b : address_a).c_str(),
+				(unsigned long long)(more_a ? b.steps() : a.steps()), (more_a ? address_a : address_b).c_str());
+			return 1;
+		}
+		differences = register_differences(record_a.registers, record_b.registers);
+		if (record_a.step != record_b.step || !differences.empty() || record_a.address != record_b.address || record_a.value != record_b.value) {
+			printf("The traces differ at step %llu", (unsigned long long)(a.steps() + (record_a.step ? 0 : 1)));
+			if (!differences.empty())
+				printf(": %s", differences.c_str());
+			printf("\n");
+			print_record(a.steps(), before, record_a);
+			print_record(b.steps(), before, record_b);
+			return 1;
+		}
+		before = record_a.registers;
+	}
+	printf("The traces are identical (%llu steps).\n", (unsigned long long)a.steps());
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	std::string command = (argc > 1 ? argv[1] : "");
+	if (command == "dump" && argc >= 3 && argc <= 5)
+		return dump(argv[2], argc > 3 ? strtoull(argv[3], nullptr, 10) : 0, argc > 4 ? strtoull(argv[4], nullptr, 10) : 0);
+	if (command == "replay" && argc == 3)
+		return replay(argv[2]);
+	if (command == "diff" && argc == 4)
+		return diff(argv[2], argv[3]);
+	print_usage(argv[0]);
+	return 1;
+}
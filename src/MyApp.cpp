@@ -1,6 +1,13 @@
 #include "MyApp.h"
+#include "Assembler.h"
+#include "Computer.h"
+#include "ControlUnit.h"
+#include "Devices.h"
+#include "History.h"
+#include "Image.h"
+#include "Refresh.h"
+#include "Worker.h"
 #include <string>
-#include <map>
 #include <algorithm>
 #include <bitset>
 #include <vector>
@@ -10,777 +17,801 @@
 #include <array>
 #include <fstream>
 #include <sstream>
+#include <cstring>
+#include <mutex>
 
 //Initial window dimensions
 #define WINDOW_WIDTH  1200
 #define WINDOW_HEIGHT 600
 
-//The values in the code table and the memory table are stored in the following arrays
-std::string labels[5000], instructions[5000], comments[5000], data[4096];
+//The time (in milliseconds) that the worker thread executes between two publications of the state for the GUI
+#define RUN_SLICE_MILLISECONDS 15
 
-//The Address symbol table
-std::map<std::string, int> label_to_address;
+//The maximum number of bytes used by the history of the execution (for the Previous button and the timeline), older steps are dropped
+#define HISTORY_LIMIT (64 * 1024 * 1024)
 
-//The registers in the Basic computer
-std::vector<uint16_t> IR, AC, DR, PC, AR, MAR, TR;
-std::vector<bool> I, E, R, IEN, FGI, FGO;
-std::vector<uint8_t> INPR, OUTR;
+//The number of steps between two full snapshots of the computer in the history, seeking executes at most this many steps
+#define CHECKPOINT_INTERVAL 1024
 
-//A vector that stores the data that is changed in the memory after each execution
-std::vector<std::pair<int, std::string>> DATA_CHANGE;
+//A copy of the code table, which is updated by editCodeRow() whenever a row is edited in the GUI
+//Only the rows that have changed since the last assembly are encoded again
+IncrementalAssembler source(5000);
 
-//Check whether the given string has a letter other than 0-9 or A-Z
-bool has_non_alphanumeric(std::string s) {
-	return std::count_if(s.begin(), s.end(), [](char c){return !(('0' <= c && c <= '9') || ('A' <= c && c <= 'Z'));}) > 0;
-}
+//The Basic computer, its memory is shown in the memory table
+//The binary strings shown in the GUI are only generated when the memory table is refreshed
+Computer computer;
 
-//Check whether the given string has a letter other than 0-9 or A-Z or space or minus(dash)
-bool has_non_alphanumeric_or_space(std::string s) {
-	return std::count_if(s.begin(), s.end(), [](char c){return !(('0' <= c && c <= '9') || ('A' <= c && c <= 'Z') || c == ' ' || c == '-');}) > 0;
-}
+//The Address symbol table
+SymbolTable symbols;
+
+//The line of the code table that each memory word has been assembled from (-1 for none), it is saved in memory images
+int source_map[4096];
+
+//Whether a program has been assembled successfully
+bool assembled = false;
+
+//The changes to the registers and the memory after each execution (used for going back to the previous state)
+History history(HISTORY_LIMIT, CHECKPOINT_INTERVAL);
+
+//Executes the computer one clock cycle at a time for the Next cycle button
+//An instruction that it has started is completed before the computer is used in any other way
+ControlUnit control_unit(computer);
+
+//Runs the program in the background for the Execute all button, so that the GUI stays responsive
+//The computer and the history belong to the worker thread while it is busy, stop_run() must be called before the GUI accesses them
+Worker worker;
+
+//The state that the worker thread publishes after each slice of execution, MyApp::OnUpdate shows it in the GUI
+struct PublishedState {
+	std::mutex mutex;
+	//Whether a state has been published since the GUI was last updated
+	bool fresh = false;
+	bool halted = false;
+	Registers registers, previous;
+	uint16_t memory[4096];
+	//The memory lines that have changed since the GUI was last updated
+	std::vector<int> changed_rows;
+	//The last executed memory line
+	int last_row = -1;
+	//The number of instructions executed since the run was started
+	uint64_t steps = 0;
+	uint64_t first = 0, position = 0, end = 0;
+	//Whether the run has stopped at a breakpoint, and the address of the watched word that has stopped it (-1 if it
+	//has stopped at an execute breakpoint)
+	bool breakpoint = false;
+	int watched = -1;
+	//The condition that has stopped the run (empty if it hasn't been stopped by a condition)
+	std::string condition;
+	//The bytes that the output device has taken since the GUI was last updated
+	std::string output;
+} published;
+
+//The breakpoints that are set in the memory table and the condition of Break when, the GUI only changes them while it
+//holds published.mutex
+Breakpoints breakpoints;
+
+//The copy of the breakpoints that the worker thread uses, it is taken at the start of each slice
+Breakpoints run_breakpoints;
+
+//Whether the next slice is the first one of a run, a run doesn't stop at the execute breakpoint that it starts from
+bool first_slice = false;
+
+//The input and output devices, which drive FGI, INPR and FGO instead of the register table while they're attached
+//They belong to the worker thread while it is busy, like the computer
+IODevices devices;
+bool devices_attached = false;
+
+//The bytes typed into the Input field that haven't been given to the input device yet, and whether the Devices box is
+//checked, the GUI only changes them while it holds published.mutex
+std::vector<uint8_t> pending_input;
+bool attach_devices = false;
+
+//Everything that the output device has taken, shown in the Output field
+std::string output_text;
+
+//The step of the history where the current run has started (the Cancel button goes back to it)
+uint64_t run_start = 0;
+
+//The memory line that is highlighted in the memory table (-1 if no line is highlighted)
+int highlighted_row = -1;
+
+//Builds the commands that refresh the register table, the changed memory lines and the timeline
+RefreshBuilder refresh_builder;
 
 //Check whether the given string has a letter other than 0 or 1
 bool has_non_binary(std::string s) {
 	return std::count_if(s.begin(), s.end(), [](char c){return !(c == '0' || c == '1');}) > 0;
 }
 
-//Check whether the given string has a letter other than 0-9 or A-F
-bool check_bad_HEX(std::string s) {
-	return std::count_if(s.begin(), s.end(), [](char c){return !(('0' <= c && c <= '9') || ('A' <= c && c <= 'F'));}) > 0;
+//Escape the single quotes, backslashes and line breaks of a string, so that it can be placed inside a javascript string
+std::string escape_js(const std::string &s) {
+	std::string result;
+	for (char c : s) {
+		if (c == '\n')
+			result += "\\n";
+		else if (c == '\r')
+			result += "\\r";
+		else {
+			if (c == '\\' || c == '\'')
+				result += '\\';
+			result += c;
+		}
+	}
+	return result;
 }
 
-//Check whether the given string has a letter other than 0-9 or a minus(dash) at the beginning
-bool check_bad_DEC(std::string s) {
-	bool x = std::count_if(s.begin(), s.end(), [](char c){return !(('0' <= c && c <= '9') || c == '-');}) > 0;
-	bool y = std::count_if(s.begin() + 1, s.end(), [](char c){return !(('0' <= c && c <= '9'));}) > 0;
-	return x & y;
+//Split a row of the code table (as sent by editCodeRow()) into its label, instruction and comment
+void split_code_row(const std::string &row, SourceLine &line) {
+	line = SourceLine();
+	std::string *field = &line.label;
+	for (char c : row) {
+		if (c == FIELD_SEPARATOR)
+			field = (field == &line.label) ? &line.instruction : &line.comment;
+		else
+			*field += c;
+	}
 }
 
+//Add the commands for updating the GUI with the current state of the computer to command
+void refreshVariablesCommand(std::string &command) {
+	refresh_builder.refresh(command, computer.registers, history.previous(computer.registers), history.first(), history.position(), history.end());
+}
 
-//Execute a memory register reference command
-void do_MRI(std::string instruction, std::string &error_text, int i, int lc) {
-	//Each MRI must be between 5 and 9 characters long (including spaces)
-	if (9 < instructions[i].size() || instructions[i].size() < 5) {
-		if (error_text.empty())
-			error_text = "Line " + std::to_string(i) + ": Invalid instruction.";
-		return;
-	}
-	//Each MRI has a three letter instruction, a space, a 1-3 letter symbolic address, and then maybe a space and I
-	//Therefor the second part which starts from index=4 is the symbolic address
-	std::string second_part = "";
-	int index = 4;
-	while (index < instructions[i].size() && instructions[i][index] != ' ')
-		second_part += instructions[i][index++];
-	//Assure that the symbolic address has a length of 1-3 characters
-	if (3 < second_part.size() || second_part.size() < 1) {
-		if (error_text.empty())
-			error_text = "Line " + std::to_string(i) + ": Invalid instruction.";
+//Move the highlight of the memory table to the given line and scroll to it (-1 removes the highlight)
+void highlight_memory_row(std::string &command, int row) {
+	highlighted_row = row;
+	command += "highlightMemoryRow(" + std::to_string(row) + ");";
+}
+
+//The changes to the GUI that are waiting for the next frame
+//The callbacks only record what has changed, and MyApp::OnUpdate turns the changes into a single script once per frame,
+//so the work of the GUI is capped at the display rate no matter how often the state changes
+struct RenderQueue {
+	//Whether the register table, the changed memory lines and the timeline have to be refreshed
+	bool refresh = false;
+	//Whether the highlight of the memory table has to be moved to highlight_row
+	bool highlight = false;
+	int highlight_row = -1;
+	//Whether the log has to show log_text (an empty log_color keeps the current color)
+	bool log = false;
+	std::string log_text, log_color;
+	//The other commands, in the order that they have been queued
+	std::string script;
+} render_queue;
+
+//Refresh the register table, the changed memory lines and the timeline on the next frame
+void queue_refresh() {
+	render_queue.refresh = true;
+}
+
+//Move the highlight of the memory table to the given line on the next frame (-1 removes the highlight)
+void queue_highlight(int row) {
+	render_queue.highlight = true;
+	render_queue.highlight_row = row;
+}
+
+//Show a message in the log on the next frame, only the last message of a frame is shown
+void queue_log(const std::string &text, const std::string &color) {
+	render_queue.log = true;
+	render_queue.log_text = text;
+	render_queue.log_color = color;
+}
+
+//Run a command on the next frame
+void queue_script(const std::string &command) {
+	render_queue.script += command;
+}
+
+//Whether the program has executed until it has reached a halt (Execute all does nothing until the program is assembled
+//or the state is changed again)
+bool finished = true;
+
+//Record the changed register values and the changed memory word after an execution
+//If the computer has halted, the step is only recorded if the PC register has changed
+//The PC register might change while the computer has halted when the Execute next button is pressed once more after it has halted
+void store_history(bool halt, const Registers &before, const std::pair<int, uint16_t> &data_change) {
+	if (halt && history.position() > 0 && !history.last_changed_pc())
 		return;
-	}
-	//Assure that the first character of the symbolic address is not a digit
-	if (isdigit(second_part[0])) {
-		if (error_text.empty())
-			error_text = "Line " + std::to_string(i) + ": The second part of an MRI must be a symbolic address.";
+	history.push(before, computer.registers, data_change, computer.memory);
+}
+
+//Give the input device the bytes that have been typed, and attach or detach the devices as the Devices box says
+//The caller holds published.mutex
+void take_device_changes() {
+	devices.input.push(pending_input.data(), pending_input.size());
+	pending_input.clear();
+	if (attach_devices && !devices_attached)
+		devices.attach(computer.registers);
+	else if (attach_devices)
+		devices.serve(computer.registers);
+	devices_attached = attach_devices;
+}
+
+//Show the bytes that the output device has taken in the Output field on the next frame
+void queue_output(const std::string &bytes) {
+	if (bytes.empty())
 		return;
+	output_text += bytes;
+	//Only the end of the output fits in the field, the other characters that can't be shown are replaced with dots
+	std::string shown = output_text.substr(output_text.size() > 80 ? output_text.size() - 80 : 0);
+	for (char &c : shown)
+		if ((unsigned char)c < 32 || (unsigned char)c > 126)
+			c = '.';
+	queue_script("deviceOutput.textContent = '" + escape_js(shown) + "';");
+}
+
+//Execute the program on the worker thread for a slice of time and publish the new state
+//Returns false when the computer has halted
+bool run_slice() {
+	//The last memory line that has been executed (the interrupt cycle doesn't execute a memory line)
+	int last_row = -1;
+	std::vector<int> changed_rows;
+	bool row_changed[4096] = {};
+	uint64_t steps = 0;
+	int watched = -1;
+	{
+		std::lock_guard<std::mutex> lock(published.mutex);
+		run_breakpoints = breakpoints;
+		take_device_changes();
 	}
-	//Check whether the symbolic address exists in the symbolic address table
-	if (label_to_address.find(second_part) == label_to_address.end()) {
-		if (error_text.empty())
-			error_text = "Line " + std::to_string(i) + ": Label not defined.";
+	bool watch = (run_breakpoints.count(BREAK_READ) + run_breakpoints.count(BREAK_WRITE) != 0);
+	Registers before = computer.registers, previous = before;
+	StopReason reason = StopReason::Breakpoint;
+	//A slice that continues the run must stop at the execute breakpoint that the previous slice has ended before
+	if (first_slice || computer.registers.R || !run_breakpoints.has(BREAK_EXECUTE, computer.registers.PC))
+		reason = computer.run_with_breakpoints(0, RUN_SLICE_MILLISECONDS, steps, run_breakpoints, [&](const std::pair<int, uint16_t> &data_change, bool halt) {
+			if (!before.R)
+				last_row = before.PC;
+			store_history(halt, before, data_change);
+			if (!row_changed[data_change.first]) {
+				row_changed[data_change.first] = true;
+				changed_rows.push_back(data_change.first);
+			}
+			if (watch)
+				watched = computer.watched_address(before.R, data_change, run_breakpoints);
+			if (devices_attached)
+				devices.serve(computer.registers);
+			previous = before;
+			before = computer.registers;
+		});
+	first_slice = false;
+	//A breakpoint after a step that isn't a watchpoint may be a condition
+	int condition = -1;
+	if (reason == StopReason::Breakpoint && watched == -1 && steps != 0)
+		condition = run_breakpoints.true_condition(previous, computer.registers, computer.memory);
+	bool halt = (reason == StopReason::Halt);
+
+	std::lock_guard<std::mutex> lock(published.mutex);
+	published.fresh = true;
+	published.halted = halt;
+	published.registers = computer.registers;
+	published.previous = history.previous(computer.registers);
+	std::memcpy(published.memory, computer.memory, sizeof(published.memory));
+	published.changed_rows.insert(published.changed_rows.end(), changed_rows.begin(), changed_rows.end());
+	if (last_row != -1)
+		published.last_row = last_row;
+	published.steps += steps;
+	published.first = history.first();
+	published.position = history.position();
+	published.end = history.end();
+	published.breakpoint = (reason == StopReason::Breakpoint);
+	published.watched = watched;
+	published.condition = (condition != -1 ? run_breakpoints.conditions()[condition].text() : "");
+	devices.output.take(published.output);
+	return reason == StopReason::TimeLimit;
+}
+
+//Take over the state that the worker thread has published since the last frame
+void take_published() {
+	std::lock_guard<std::mutex> lock(published.mutex);
+	if (!published.fresh)
 		return;
+	published.fresh = false;
+	queue_highlight(published.last_row);
+	for (size_t i = 0; i < published.changed_rows.size(); i++)
+		refresh_builder.mark_row_dirty(published.changed_rows[i]);
+	published.changed_rows.clear();
+	queue_output(published.output);
+	published.output.clear();
+	queue_refresh();
+	if (published.halted) {
+		queue_log("Execution finished.", "rgb(10, 110, 10)");
+		finished = true;
 	}
-	//Save the first character of the data in memory based on whether the addressing is direct or indirect
-	//Based on the size, check whether an I (indirect addressing) exists as it should
-	if (instructions[i].size() == 4 + second_part.size() + 2) {
-		if (instructions[i][instructions[i].size() - 2] != ' ' || instructions[i].back() != 'I') {
-			if (error_text.empty())
-				error_text = "Line " + std::to_string(i) + ": Invalid instruction.";
-			return;
-		}
-		else
-			data[lc] = "1";
+	else if (published.breakpoint && !published.condition.empty())
+		queue_log("Stopped by the condition " + published.condition + " after " + std::to_string(published.steps) + " instructions.", "rgb(0, 0, 0)");
+	else if (published.breakpoint) {
+		char address[4];
+		snprintf(address, sizeof(address), "%03X", published.watched != -1 ? published.watched : published.registers.PC);
+		std::string text = (published.watched != -1 ? "Stopped by the watchpoint at " : "Stopped at the breakpoint at ");
+		queue_log(text + address + " after " + std::to_string(published.steps) + " instructions.", "rgb(0, 0, 0)");
 	}
-	//Save the first character as 0 if the addressing is direct
-	else if (instructions[i].size() == 4 + second_part.size())
-		data[lc] = "0";
-	else {
-		if (error_text.empty())
-			error_text = "Line " + std::to_string(i) + ": Invalid instruction.";
+	else
+		queue_log("Executed " + std::to_string(published.steps) + " instructions.", "rgb(0, 0, 0)");
+}
+
+//Stop the execution on the worker thread, so that the GUI can access the computer and the history again
+//Returns true if the computer has halted during the last run
+bool stop_run() {
+	worker.stop();
+	take_published();
+	return published.halted;
+}
+
+//Serve the devices after an instruction that the GUI thread has executed
+void serve_devices() {
+	if (!devices_attached)
 		return;
+	devices.serve(computer.registers);
+	std::string bytes;
+	devices.output.take(bytes);
+	queue_output(bytes);
+}
+
+//Detach the devices and empty them and the Output field, as a new program starts from nothing
+void reset_devices() {
+	{
+		std::lock_guard<std::mutex> lock(published.mutex);
+		pending_input.clear();
 	}
-	//Save the next three characters (OP-Code) based on the operation
-	if (instruction == "AND")
-		data[lc] += "000";
-	else if (instruction == "ADD")
-		data[lc] += "001";
-	else if (instruction == "LDA")
-		data[lc] += "010";
-	else if (instruction == "STA")
-		data[lc] += "011";
-	else if (instruction == "BUN")
-		data[lc] += "100";
-	else if (instruction == "BSA")
-		data[lc] += "101";
-	else if (instruction == "ISZ")
-		data[lc] += "110";
-	//Save the address obtained from the symbolic address table in the last 12 characters
-	data[lc] += std::bitset<12>(label_to_address[second_part]).to_string();
-	return;
+	devices.input.clear();
+	devices.output.clear();
+	devices_attached = false;
+	output_text.clear();
+	queue_script("deviceOutput.textContent = '';");
 }
 
-//Update the values of the register table in the GUI
-void refreshVariablesCommand(std::string &command) {
-	command = "document.getElementById('IR').innerHTML = '" + std::bitset<16>(IR.back()).to_string() + "';";
-	command += "document.getElementById('I').innerHTML = '" + std::bitset<1>(I.back()).to_string() + "';";
-	command += "document.getElementById('AC').innerHTML = '" + std::bitset<16>(AC.back()).to_string() + "';";
-	command += "document.getElementById('DR').innerHTML = '" + std::bitset<16>(DR.back()).to_string() + "';";
-	command += "document.getElementById('PC').innerHTML = '" + std::bitset<12>(PC.back()).to_string() + "';";
-	command += "document.getElementById('AR').innerHTML = '" + std::bitset<12>(AR.back()).to_string() + "';";
-	command += "document.getElementById('MAR').innerHTML = '" + std::bitset<16>(MAR.back()).to_string() + "';";
-	command += "document.getElementById('E').innerHTML = '" + std::bitset<1>(E.back()).to_string() + "';";
-	command += "document.getElementById('TR').innerHTML = '" + std::bitset<16>(TR.back()).to_string() + "';";
-	command += "document.getElementById('INPR').value = '" + std::bitset<8>(INPR.back()).to_string() + "';";
-	command += "document.getElementById('OUTR').innerHTML = '" + std::bitset<8>(OUTR.back()).to_string() + "';";
-	command += "document.getElementById('R').innerHTML = '" + std::bitset<1>(R.back()).to_string() + "';";
-	command += "document.getElementById('IEN').innerHTML = '" + std::bitset<1>(IEN.back()).to_string() + "';";
-	command += "document.getElementById('FGI').value = '" + std::bitset<1>(FGI.back()).to_string() + "';";
-	command += "document.getElementById('FGO').value = '" + std::bitset<1>(FGO.back()).to_string() + "';";
-
-	command += "document.getElementById('preIR').innerHTML = '" + std::bitset<16>(IR[IR.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preI').innerHTML = '" + std::bitset<1>(I[I.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preAC').innerHTML = '" + std::bitset<16>(AC[AC.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preDR').innerHTML = '" + std::bitset<16>(DR[DR.size() - 2]).to_string() + "';";
-	command += "document.getElementById('prePC').innerHTML = '" + std::bitset<12>(PC[PC.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preAR').innerHTML = '" + std::bitset<12>(AR[AR.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preMAR').innerHTML = '" + std::bitset<16>(MAR[MAR.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preE').innerHTML = '" + std::bitset<1>(E[E.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preTR').innerHTML = '" + std::bitset<16>(TR[TR.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preINPR').innerHTML = '" + std::bitset<8>(INPR[INPR.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preOUTR').innerHTML = '" + std::bitset<8>(OUTR[OUTR.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preR').innerHTML = '" + std::bitset<1>(R[R.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preIEN').innerHTML = '" + std::bitset<1>(IEN[IEN.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preFGI').innerHTML = '" + std::bitset<1>(FGI[FGI.size() - 2]).to_string() + "';";
-	command += "document.getElementById('preFGO').innerHTML = '" + std::bitset<1>(FGO[FGO.size() - 2]).to_string() + "';";
-	command += "makeHEXs();";
-	for (int i = 0; i < 4096; i++)
-			command += "document.getElementsByClassName('rowData')[" + std::to_string(i) + "].innerHTML = '" + data[i] + "';";
+//Execute the clock cycles until the current instruction (or the one that Next cycle has started) is completed, and record it
+//Returns true if the computer has halted
+bool complete_instruction() {
+	std::pair<int, uint16_t> data_change;
+	bool halt = control_unit.step(data_change);
+	store_history(halt, control_unit.before(), data_change);
+	serve_devices();
+	refresh_builder.mark_row_dirty(data_change.first);
+	queue_refresh();
+	return halt;
+}
+
+//Undo the clock cycles of an instruction that Next cycle has started
+//Returns false if no instruction has been started
+bool abort_instruction() {
+	if (control_unit.timing_signal() == 0)
+		return false;
+	std::pair<int, uint16_t> data_change;
+	if (control_unit.data_change(data_change))
+		refresh_builder.mark_row_dirty(data_change.first);
+	control_unit.abort();
+	queue_refresh();
+	return true;
 }
 
 //The assembler function
 JSValueRef assemble(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
-	JSStringRef script;
-	std::string command = "", result;
-	//Clear the symbolic address table
-	label_to_address.clear();
-	//Clear the memory
-	for (int i = 0; i < 4096; i++) {
-		data[i] = "0000000000000000";
-		command += "document.getElementsByClassName('memoryRow')[" + std::to_string(i) + "].style.backgroundColor = 'initial';";
-	}
-	script = JSStringCreateWithUTF8CString(command.c_str());
-	JSEvaluateScript(ctx, script, 0, 0, 0, 0);
+	stop_run();
+	control_unit.reset();
+	//Clear the memory highlight
+	queue_highlight(-1);
+
+	//Assemble the copy of the code table, only the changed lines are encoded again and only the changed memory words
+	//are written
+	std::string error_text;
+	std::vector<int> changed_words;
+	computer.reset_registers();
+	reset_devices();
+	assembled = false;
+	bool success = source.assemble(computer.memory, symbols, error_text, changed_words, source_map);
+	history.start(computer);
 
-	//Fetch each line of the code from the GUI
-	for (int i = 0; i < 5000; i++) {
-		command = "document.getElementsByClassName('rowLabelInput')[" + std::to_string(i) + "].value.toString()";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		result = std::string(String(JSString(JSValueToStringCopy(ctx, JSEvaluateScript(ctx, script, 0, 0, 0, 0), 0))).utf8().data());
-		std::transform(result.begin(), result.end(), result.begin(), ::toupper);
-		labels[i] = result;
-		command = "document.getElementsByClassName('rowInstructionInput')[" + std::to_string(i) + "].value.toString()";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		result = std::string(String(JSString(JSValueToStringCopy(ctx, JSEvaluateScript(ctx, script, 0, 0, 0, 0), 0))).utf8().data());
-		std::transform(result.begin(), result.end(), result.begin(), ::toupper);
-		instructions[i] = result;
-		command = "document.getElementsByClassName('rowCommentInput')[" + std::to_string(i) + "].value.toString()";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		result = std::string(String(JSString(JSValueToStringCopy(ctx, JSEvaluateScript(ctx, script, 0, 0, 0, 0), 0))).utf8().data());
-		comments[i] = result;
+	//If an error has occurred, display the error on the GUI
+	if (!success)
+		queue_log(error_text, "rgb(110, 10, 10)");
+	//If no has occurred, display a success message on the GUI and initialize the registers
+	else {
+		queue_log("Program assembled successfully.", "rgb(10, 110, 10)");
+		for (size_t i = 0; i < changed_words.size(); i++)
+			refresh_builder.mark_row_dirty(changed_words[i]);
+		refresh_builder.mark_registers_dirty();
+		queue_refresh();
+		assembled = true;
+		finished = false;
 	}
 
-	std::string error_text = "";
-
-	//Run the first pass of the assembler + Error detection
-	int lc = -1;
-	for (int i = 0; i < 5000; i++) {
-		lc++;
-		if (!comments[i].empty()) {
-			if (comments[i][0] != '/') {
-				if (error_text.empty())
-					error_text = "Line " + std::to_string(i) + ": Comments must start with \\'/\\'.";
-				break;
-			}
-		}
-		if (!labels[i].empty()) {
-			if (labels[i].back() != ',') {
-				if (error_text.empty())
-					error_text = "Line " + std::to_string(i) + ": Labels must end with \\',\\'.";
-				break;
-			}
-			if (instructions[i] == "END" || (instructions[i].size() > 3 && instructions[i].substr(0, 3) == "ORG")) {
-				if (error_text.empty())
-					error_text = "Line " + std::to_string(i) + ": ORG and END instructions must not have labels.";
-				break;
-			}
-			else if (labels[i].size() > 4 || has_non_alphanumeric(labels[i].substr(0, labels[i].size() - 1))) {
-				if (error_text.empty())
-					error_text = "Line " + std::to_string(i) + ": Invalid label.";
-				break;
-			}
-			else if (label_to_address.find(labels[i].substr(0, labels[i].size() - 1)) != label_to_address.end()) {
-				if (error_text.empty())
-					error_text = "Line " + std::to_string(i) + ": Label redefined.";
-				break;
-			}
-			else
-				label_to_address[labels[i].substr(0, labels[i].size() - 1)] = lc;
-		}
-		else if (instructions[i] == "END")
-			break;
-		else if (instructions[i].size() > 3 && instructions[i].substr(0, 3) == "ORG") {
-			if (instructions[i].size() < 5 || instructions[i][3] != ' ' || has_non_alphanumeric(instructions[i].substr(4))) {
-				if (error_text.empty())
-					error_text = "Line " + std::to_string(i) + ": Invalid ORG instruction.";
-				break;
-			}
-			else {
-				int org_line = std::stoi(instructions[i].substr(4), nullptr, 16);
-				lc = org_line - 1;
-			}
-		}
-	}
+	return JSValueMakeNull(ctx);
+}
 
-	//Run the second pass of the assembler + Error detection
-	lc = -1;
-	for (int i = 0; i < 5000; i++) {
-		if (labels[i].empty() && instructions[i].empty())
-			continue;
-		lc++;
-		if (instructions[i].size() < 3 || has_non_alphanumeric_or_space(instructions[i])) {
-			if (error_text.empty())
-				error_text = "Line " + std::to_string(i) + ": Invalid instruction.";
-			break;
-		}
-		else {
-			std::string instruction = instructions[i].substr(0, 3);
-			if (instruction == "END")
-				break;
-			else if (lc >= 4096) {
-				if (error_text.empty())
-					error_text = "Line " + std::to_string(i) + ": LC exceeded 4095.";
-				break;
-			}
-			else if (instruction == "ORG") {
-				if (instructions[i].size() < 5 || instructions[i][3] != ' ' || has_non_alphanumeric(instructions[i].substr(4))) {
-					if (error_text.empty())
-						error_text = "Line " + std::to_string(i) + ": Invalid ORG instruction";
-					break;
-				}
-				else {
-					int org_line = std::stoi(instructions[i].substr(4), nullptr, 16);
-					lc = org_line - 1;
-				}
-			}
-			else if (instruction == "HEX") {
-				if (instructions[i].size() < 5 || instructions[i][3] != ' ') {
-					if (error_text.empty())
-						error_text = "Line " + std::to_string(i) + ": Invalid HEX instruction.";
-					break;
-				}
-				else {
-					if (check_bad_HEX(instructions[i].substr(4))) {
-						if (error_text.empty())
-							error_text = "Line " + std::to_string(i) + ": Invalid HEX number.";
-						break;
-					}
-					int hex_value = std::stoi(instructions[i].substr(4), nullptr, 16);
-					if (hex_value > 65535) {
-						if (error_text.empty())
-							error_text = "Line " + std::to_string(i) + ": HEX number out of range.";
-						break;
-					}
-					data[lc] = std::bitset<16>(hex_value).to_string();
-				}
-			}
-			else if (instruction == "DEC") {
-				if (instructions[i].size() < 5 || instructions[i][3] != ' ') {
-					if (error_text.empty())
-						error_text = "Line " + std::to_string(i) + ": Invalid DEC instruction.";
-					break;
-				}
-				else {
-					if (check_bad_DEC(instructions[i].substr(4))) {
-						if (error_text.empty())
-							error_text = "Line " + std::to_string(i) + ": Invalid DEC number.";
-						break;
-					}
-					int dec_value = std::stoi(instructions[i].substr(4));
-					if (32767 < dec_value || dec_value < -32768) {
-						if (error_text.empty())
-							error_text = "Line " + std::to_string(i) + ": DEC number out of range.";
-						break;
-					}
-					data[lc] = std::bitset<16>(dec_value).to_string();
-				}
-			}
-			else if (instruction == "AND" || instruction == "ADD" || instruction == "LDA" || instruction == "STA" || instruction == "BUN" || instruction == "BSA" || instruction == "ISZ") {
-				do_MRI(instruction, error_text, i, lc);
-				if (!error_text.empty())
-					break;
-			}
-			else if (instructions[i].size() != 3) {
-				if (error_text.empty())
-					error_text = "Line " + std::to_string(i) + ": A non-MRI instruction must have 3 characters.";
-				break;
-			}
-			else if (instruction == "CLA")
-				data[lc] = "0111100000000000";
-			else if (instruction == "CLE")
-				data[lc] = "0111010000000000";
-			else if (instruction == "CMA")
-				data[lc] = "0111001000000000";
-			else if (instruction == "CME")
-				data[lc] = "0111000100000000";
-			else if (instruction == "CIR")
-				data[lc] = "0111000010000000";
-			else if (instruction == "CIL")
-				data[lc] = "0111000001000000";
-			else if (instruction == "INC")
-				data[lc] = "0111000000100000";
-			else if (instruction == "SPA")
-				data[lc] = "0111000000010000";
-			else if (instruction == "SNA")
-				data[lc] = "0111000000001000";
-			else if (instruction == "SZA")
-				data[lc] = "0111000000000100";
-			else if (instruction == "SZE")
-				data[lc] = "0111000000000010";
-			else if (instruction == "HLT")
-				data[lc] = "0111000000000001";
-			else if (instruction == "INP")
-				data[lc] = "1111100000000000";
-			else if (instruction == "OUT")
-				data[lc] = "1111010000000000";
-			else if (instruction == "SKI")
-				data[lc] = "11110010000000000";
-			else if (instruction == "SKO")
-				data[lc] = "1111000100000000";
-			else if (instruction == "ION")
-				data[lc] = "1111000010000000";
-			else if (instruction == "IOF")
-				data[lc] = "1111000001000000";
-			else if (error_text.empty())
-				error_text = "Line " + std::to_string(i) + ": Invalid instruction.";
-		}
-	}
+//Update a row of the copy of the code table, called by the GUI whenever a cell of the row is edited
+//The arguments are the index of the row and its cells, separated by \x1F
+JSValueRef edit_code_row(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	if (argumentCount < 2 || !JSValueIsNumber(ctx, arguments[0]))
+		return JSValueMakeNull(ctx);
 
-	//If an error has occurred, display the error on the GUI
-	if (!error_text.empty()) {
-		command = "document.getElementById('log').innerHTML = '" + error_text + "';document.getElementById('log').style.color = 'rgb(110, 10, 10)';";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
+	double row = JSValueToNumber(ctx, arguments[0], 0);
+	if (row < 0 || row >= double(source.lines().size()))
+		return JSValueMakeNull(ctx);
+	SourceLine line;
+	split_code_row(std::string(String(JSString(JSValueToStringCopy(ctx, arguments[1], 0))).utf8().data()), line);
+	source.set_line(size_t(row), line);
+
+	return JSValueMakeNull(ctx);
+}
+
+//Read the first and the count arguments of getCodeRows() and getMemoryRows(), and clamp them to the given number of rows
+bool read_row_range(JSContextRef ctx, size_t argumentCount, const JSValueRef arguments[], size_t rows, size_t &first, size_t &count) {
+	if (argumentCount < 2 || !JSValueIsNumber(ctx, arguments[0]) || !JSValueIsNumber(ctx, arguments[1]))
+		return false;
+	double first_value = JSValueToNumber(ctx, arguments[0], 0), count_value = JSValueToNumber(ctx, arguments[1], 0);
+	if (!(first_value >= 0 && first_value < double(rows) && count_value >= 0))
+		return false;
+	first = size_t(first_value);
+	count = size_t(std::min(count_value, double(rows - first)));
+	return true;
+}
+
+//Return a string to javascript
+JSValueRef make_string(JSContextRef ctx, const std::string &s) {
+	JSStringRef string = JSStringCreateWithUTF8CString(s.c_str());
+	JSValueRef result = JSValueMakeString(ctx, string);
+	JSStringRelease(string);
+	return result;
+}
+
+//Get the rows of the code table from the first argument, the number of rows is the second argument
+//The rows are separated by \x1E and their cells are separated by \x1F, only the visible rows are requested by the GUI
+JSValueRef get_code_rows(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	const std::vector<SourceLine> &lines = source.lines();
+	size_t first, count;
+	if (!read_row_range(ctx, argumentCount, arguments, lines.size(), first, count))
+		return make_string(ctx, "");
+
+	std::string rows;
+	for (size_t i = first; i < first + count; i++) {
+		if (i > first)
+			rows += ROW_SEPARATOR;
+		rows += lines[i].label + FIELD_SEPARATOR + lines[i].instruction + FIELD_SEPARATOR + lines[i].comment;
 	}
-	//If no has occurred, display a success message on the GUI and initialize the registers
-	else {
-		command = "document.getElementById('log').innerHTML = 'Program assembled successfully.';document.getElementById('log').style.color = 'rgb(10, 110, 10)';";
-		for (int i = 0; i < 4096; i++)
-			command += "document.getElementsByClassName('rowData')[" + std::to_string(i) + "].innerHTML = '" + data[i] + "';";
-		IR.clear();
-		IR.push_back(0);
-		I.clear();
-		I.push_back(0);
-		AC.clear();
-		AC.push_back(0);
-		DR.clear();
-		DR.push_back(0);
-		PC.clear();
-		PC.push_back(0);
-		AR.clear();
-		AR.push_back(0);
-		MAR.clear();
-		MAR.push_back(0);
-		E.clear();
-		E.push_back(0);
-		TR.clear();
-		TR.push_back(0);
-		INPR.clear();
-		INPR.push_back(0);
-		OUTR.clear();
-		OUTR.push_back(0);
-		R.clear();
-		R.push_back(0);
-		IEN.clear();
-		IEN.push_back(0);
-		FGI.clear();
-		FGI.push_back(0);
-		FGO.clear();
-		FGO.push_back(0);
-		DATA_CHANGE.clear();
-		DATA_CHANGE.emplace_back(0, "0000000000000000");
-		command += "finished = false;";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
+	return make_string(ctx, rows);
+}
+
+//Get the binary values of the memory lines from the first argument, the number of lines is the second argument
+//The values are separated by \x1E, each one is followed by \x1F and the execute, read and write breakpoints of the line
+//as three 0/1 digits
+JSValueRef get_memory_rows(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	size_t first, count;
+	if (!read_row_range(ctx, argumentCount, arguments, 4096, first, count))
+		return make_string(ctx, "");
+
+	//While the worker thread runs, the memory belongs to it and the published copy is shown
+	std::string rows;
+	std::unique_lock<std::mutex> lock(published.mutex, std::defer_lock);
+	const uint16_t *memory = computer.memory;
+	if (worker.busy()) {
+		lock.lock();
+		memory = published.memory;
 	}
+	memory_rows(rows, memory, first, count, breakpoints);
+	return make_string(ctx, rows);
+}
 
-	JSStringRelease(script);
+//Give the characters of the first argument to the input device, they are read after the ones that have been given before
+JSValueRef feed_input(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	if (argumentCount < 1 || !JSValueIsString(ctx, arguments[0]))
+		return JSValueMakeNull(ctx);
+	std::string text = std::string(String(JSString(JSValueToStringCopy(ctx, arguments[0], 0))).utf8().data());
+
+	//A running worker takes the bytes at the start of its next slice
+	{
+		std::lock_guard<std::mutex> lock(published.mutex);
+		pending_input.insert(pending_input.end(), text.begin(), text.end());
+	}
+	if (!attach_devices)
+		queue_log("The input is given to the program once Devices is checked.", "rgb(0, 0, 0)");
 
 	return JSValueMakeNull(ctx);
 }
 
+//Attach the devices if the first argument is true, and detach them if it is false
+JSValueRef set_devices(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	if (argumentCount < 1 || !JSValueIsBoolean(ctx, arguments[0]))
+		return JSValueMakeNull(ctx);
+	std::lock_guard<std::mutex> lock(published.mutex);
+	attach_devices = JSValueToBoolean(ctx, arguments[0]);
 
-//Execute the next instruction
-JSValueRef execute_next(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
-	JSStringRef script;
-	std::string command, result;
+	return JSValueMakeNull(ctx);
+}
 
-	//If the IR register is empty, then the program hasn't been assembled yet
-	if (IR.empty()) {
-		command = "document.getElementById('log').innerHTML = 'No data has been assembled.';document.getElementById('log').style.color = 'rgb(110, 10, 10)';";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-		JSStringRelease(script);
+//Set the condition of Break when from the first argument, Execute all stops after a step that makes it true
+//An empty condition removes it
+JSValueRef set_condition(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	if (argumentCount < 1 || !JSValueIsString(ctx, arguments[0]))
 		return JSValueMakeNull(ctx);
-	}
+	std::string text = std::string(String(JSString(JSValueToStringCopy(ctx, arguments[0], 0))).utf8().data());
 
-	//A flag that becomes true when the computer halts
-	bool halt = false;
-
-	//The register values of the current execution
-	uint16_t ir, ac, dr, pc, ar, mar, tr;
-	bool i, e, r, ien, fgi, fgo;
-	uint8_t inpr, outr;
-	std::pair<int, std::string> data_change;
-	
-	//Initialize the register values
-	ir = IR.back();
-	ac = AC.back();
-	dr = DR.back();
-	pc = PC.back();
-	ar = AR.back();
-	mar = MAR.back();
-	tr = TR.back();
-	i = I.back();
-	e = E.back();
-	r = R.back();
-	ien = IEN.back();
-	//Get FGI from user input
-	command = "FGI.value.toString()";
-	script = JSStringCreateWithUTF8CString(command.c_str());
-	result = std::string(String(JSString(JSValueToStringCopy(ctx, JSEvaluateScript(ctx, script, 0, 0, 0, 0), 0))).utf8().data());
-	if (result.size() != 1 || has_non_binary(result)) {
-		command = "document.getElementById('log').innerHTML = 'FGI must be a 1 digit binary number.';document.getElementById('log').style.color = 'rgb(110, 10, 10)';";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-		JSStringRelease(script);
+	Condition condition;
+	std::string error_text;
+	bool empty = (text.find_first_not_of(" \t") == std::string::npos);
+	if (!empty && !condition.compile(text, error_text)) {
+		queue_log(error_text, "rgb(110, 10, 10)");
 		return JSValueMakeNull(ctx);
 	}
-	fgi = std::stoi(result, nullptr, 2);
-	//Get FGO from user input
-	command = "FGO.value.toString()";
-	script = JSStringCreateWithUTF8CString(command.c_str());
-	result = std::string(String(JSString(JSValueToStringCopy(ctx, JSEvaluateScript(ctx, script, 0, 0, 0, 0), 0))).utf8().data());
-	if (result.size() != 1 || has_non_binary(result)) {
-		command = "document.getElementById('log').innerHTML = 'FGO must be a 1 digit binary number.';document.getElementById('log').style.color = 'rgb(110, 10, 10)';";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-		JSStringRelease(script);
+	{
+		std::lock_guard<std::mutex> lock(published.mutex);
+		breakpoints.clear_conditions();
+		if (!empty)
+			breakpoints.add_condition(condition);
+	}
+	queue_log(empty ? "The condition has been removed." : "Execute all stops when " + text + ".", "rgb(0, 0, 0)");
+
+	return JSValueMakeNull(ctx);
+}
+
+//Set or remove a breakpoint of the memory table, the first argument is the memory line and the second argument is the
+//kind of the breakpoint (0 for execute, 1 for read and 2 for write)
+JSValueRef toggle_breakpoint(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	if (argumentCount < 2 || !JSValueIsNumber(ctx, arguments[0]) || !JSValueIsNumber(ctx, arguments[1]))
 		return JSValueMakeNull(ctx);
+	double row = JSValueToNumber(ctx, arguments[0], 0), kind = JSValueToNumber(ctx, arguments[1], 0);
+	if (!(row >= 0 && row < 4096) || !(kind >= BREAK_EXECUTE && kind <= BREAK_WRITE))
+		return JSValueMakeNull(ctx);
+
+	//A running worker takes the new breakpoints at the start of its next slice
+	{
+		std::lock_guard<std::mutex> lock(published.mutex);
+		breakpoints.set(BreakpointKind(int(kind)), int(row), !breakpoints.has(BreakpointKind(int(kind)), int(row)));
 	}
-	fgo = std::stoi(result, nullptr, 2);
-	//Get INPR from user input
-	command = "INPR.value.toString()";
+	refresh_builder.mark_row_dirty(int(row));
+	queue_refresh();
+
+	return JSValueMakeNull(ctx);
+}
+
+
+//Read a value from an input of the register table and check that it is a binary number with the given number of digits
+//If it isn't, display an error on the GUI and return false
+bool read_binary_input(JSContextRef ctx, const std::string &name, size_t digits, const std::string &error_text, int &value) {
+	JSStringRef script;
+	std::string command, result;
+	command = name + ".value.toString()";
 	script = JSStringCreateWithUTF8CString(command.c_str());
 	result = std::string(String(JSString(JSValueToStringCopy(ctx, JSEvaluateScript(ctx, script, 0, 0, 0, 0), 0))).utf8().data());
-	if (result.size() != 8 || has_non_binary(result)) {
-		command = "document.getElementById('log').innerHTML = 'INPR must be an 8 digit binary number.';document.getElementById('log').style.color = 'rgb(110, 10, 10)';";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-		JSStringRelease(script);
-		return JSValueMakeNull(ctx);
+	JSStringRelease(script);
+	if (result.size() != digits || has_non_binary(result)) {
+		queue_log(error_text, "rgb(110, 10, 10)");
+		return false;
 	}
-	inpr = std::stoi(result, nullptr, 2);
-	outr = OUTR.back();
-
-	//If the R flag is true, run the interrupt cycle
-	if (r) {
-		ar = 0;
-		tr = pc;
-		data[ar] = std::bitset<16>(tr).to_string();
-		mar = (std::stoi(data[ar], nullptr, 2));
-		pc = 0;
-		pc = pc + 1;
-		ien = 0;
-		r = 0;
+	value = std::stoi(result, nullptr, 2);
+	return true;
+}
+
+//Get FGI, FGO and INPR from user input
+//Returns false if the program hasn't been assembled yet or the user input is invalid
+bool prepare_registers(JSContextRef ctx) {
+	if (!assembled) {
+		queue_log("No data has been assembled.", "rgb(110, 10, 10)");
+		return false;
 	}
-	//If the R flag is false, run the instruction cycle
-	else {
-		//Highlight the current memory line that is being executed in the GUI
-		command = "";
-		if (PC.size() > 1)
-			command += "document.getElementsByClassName('memoryRow')[" + std::to_string(PC[PC.size() - 2]) + "].style.backgroundColor = 'initial';";
-		command += "document.getElementsByClassName('memoryRow')[" + std::to_string(PC[PC.size() - 1]) + "].style.backgroundColor = 'rgb(220, 255, 220)';";
-		command += "document.getElementsByClassName('memoryRow')[" + std::to_string(PC[PC.size() - 1]) + "].scrollIntoView(false);";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-
-		//Fetch and decode
-		ar = pc;
-		mar = std::stoi(data[ar], nullptr, 2);
-	
-		ir = mar;
-		pc = pc + 1;
-
-		int opcode = ((ir & ((1 << 15) - 1)) >> 12);
-		ar = (ir & ((1 << 12) - 1));
-		mar = std::stoi(data[ar], nullptr, 2);
-		i = (ir >> 15);
-		
-		//Save the data that might be changed in the current execution along with its address
-		data_change = std::make_pair(ar, data[ar]);
-
-		//Execute register-reference instruction (starts with 7) or IO instruction (starts with F)
-		if (opcode == 7) {
-			switch(ir) {
-				case 0x7800: {
-					ac = 0;
-					break;
-				}
-				case 0x7400: {
-					e = 0;
-					break;
-				}
-				case 0x7200: {
-					ac = ~ac;
-					break;
-				}
-				case 0x7100: {
-					e = !e;
-					break;
-				}
-				case 0x7080: {
-					bool tmp = e;
-					e = (ac & 1);
-					ac = ((ac >> 1) | (uint16_t(tmp) << 15));
-					break;
-				}
-				case 0x7040: {
-					bool tmp = e;
-					e = ((ac & (1 << 15)) >> 15);
-					ac = ((ac << 1) | uint16_t(e));
-					break;
-				}
-				case 0x7020: {
-					ac = ac + 1;
-					break;
-				}
-				case 0x7010: {
-					if ((ac & (1 << 15)) == 0)
-						pc = pc + 1;
-					break;
-				}
-				case 0x7008: {
-					if ((ac & (1 << 15)) != 0)
-						pc = pc + 1;
-					break;
-				}
-				case 0x7004: {
-					if (ac == 0)
-						pc = pc + 1;
-					break;
-				}
-				case 0x7002: {
-					if (e == 0)
-						pc = pc + 1;
-					break;
-				}
-				case 0x7001: {
-					halt = true;
-					break;
-				}
-				case 0xF800: {
-					ac = inpr;
-					fgi = 0;
-					break;
-				}
-				case 0xF400: {
-					outr = (ac & ((1 << 8) - 1));
-					fgo = 0;
-					break;
-				}
-				case 0xF200: {
-					if (fgi == 1)
-						pc = pc + 1;
-					break;
-				}
-				case 0xF100: {
-					if (fgo == 1)
-						pc = pc + 1;
-					break;
-				}
-				case 0xF080: {
-					ien = 1;
-					break;
-				}
-				case 0xF040: {
-					ien = 0;
-					break;
-				}
-			}
-		}
-		//Execute memory-reference instruction
-		else {
-			if (i) {
-				ar = (mar & ((1 << 12) - 1));
-				mar = std::stoi(data[ar], nullptr, 2);
-			}
-			switch (opcode) {
-				case 0b000: {
-					dr = mar;
-					ac = (ac & dr);
-					break;
-				}
-				case 0b001: {
-					dr = mar;
-					ac = ac + dr;
-					e = ((ac >> 15) & (dr >> 15));
-					break;
-				}
-				case 0b010: {
-					dr = mar;
-					ac = dr;
-					break;
-				}
-				case 0b011: {
-					data[ar] = std::bitset<16>(ac).to_string();
-					mar = (std::stoi(data[ar], nullptr, 2));
-					break;
-				}
-				case 0b100: {
-					pc = ar;
-					break;
-				}
-				case 0b101: {
-					data[ar] = std::bitset<16>(pc).to_string();
-					ar = ar + 1;
-					mar = (std::stoi(data[ar], nullptr, 2));
-					pc = ar;
-					break;
-				}
-				case 0b110: {
-					dr = mar;
-					dr = dr + 1;
-					data[ar] = std::bitset<16>(dr).to_string();
-					mar = (std::stoi(data[ar], nullptr, 2));
-					if (dr == 0)
-						pc = pc + 1;
-					break;
-				}
-			}
-		}
+
+	//The attached devices drive the inputs, so the register table isn't read
+	{
+		std::lock_guard<std::mutex> lock(published.mutex);
+		take_device_changes();
 	}
-	//Check the conditions for the R flag
-	r = ien & (fgo | fgi);
-	//If the computer has halted, then the PC register shouldn't be incremented
-	if (halt)
-		pc = pc - 1;
-	//If the computer hasn't halted or the PC register has changed, store the new register values
-	//The PC register might change while the computer has halted when the Execute next button is pressed once more after it has halted
-	if (!halt || PC[PC.size() - 2] != PC.back()) {
-		IR.push_back(ir);
-		AC.push_back(ac);
-		DR.push_back(dr);
-		PC.push_back(pc);
-		AR.push_back(ar);
-		MAR.push_back(mar);
-		TR.push_back(tr);
-		I.push_back(i);
-		E.push_back(e);
-		R.push_back(r);
-		IEN.push_back(ien);
-		FGI.push_back(fgi);
-		FGO.push_back(fgo);
-		INPR.push_back(inpr);
-		OUTR.push_back(outr);
-		DATA_CHANGE.push_back(data_change);
+	if (devices_attached) {
+		std::string bytes;
+		devices.output.take(bytes);
+		queue_output(bytes);
+		return true;
 	}
 
-	//Update the register values in the GUI
-	refreshVariablesCommand(command);
+	//If the register table hasn't been refreshed since the last change, the inputs still show older values, which will be
+	//replaced by the ones of the computer on the next frame
+	if (render_queue.refresh)
+		return true;
+
+	Registers &registers = computer.registers;
+	int fgi, fgo, inpr;
+	if (!read_binary_input(ctx, "FGI", 1, "FGI must be a 1 digit binary number.", fgi) ||
+		!read_binary_input(ctx, "FGO", 1, "FGO must be a 1 digit binary number.", fgo) ||
+		!read_binary_input(ctx, "INPR", 8, "INPR must be an 8 digit binary number.", inpr))
+		return false;
+	registers.FGI = fgi;
+	registers.FGO = fgo;
+	registers.INPR = inpr;
+	return true;
+}
+
+//Execute the next instruction
+JSValueRef execute_next(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	stop_run();
+	//If Next cycle has started an instruction, its inputs have already been read and it is completed
+	if (control_unit.timing_signal() == 0) {
+		if (!prepare_registers(ctx))
+			return JSValueMakeNull(ctx);
+
+		//Highlight the current memory line that is being executed in the GUI (the interrupt cycle doesn't execute a memory line)
+		if (!computer.registers.R)
+			queue_highlight(computer.registers.PC);
+	}
 
-	script = JSStringCreateWithUTF8CString(command.c_str());
-	JSEvaluateScript(ctx, script, 0, 0, 0, 0);
+	//Run the instruction cycle or the interrupt cycle, and update the register values in the GUI
+	bool halt = complete_instruction();
 
 	//If the computer has halted, display a finish message
 	if (halt) {
-		command = "log.innerHTML = 'Execution finished.';log.style.color = 'rgb(10, 110, 10)';";
-		command += "finished = true;";
+		queue_log("Execution finished.", "rgb(10, 110, 10)");
+		finished = true;
 	}
 	//If not, clear the message log
 	else
-		command = "log.innerHTML = '';";
-	script = JSStringCreateWithUTF8CString(command.c_str());
-	JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-	
-	JSStringRelease(script);
+		queue_log("", "");
+
+	return JSValueMakeNull(ctx);
+}
+
+//Execute the next clock cycle: the micro-operations of the current timing signal
+JSValueRef execute_cycle(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	stop_run();
+	//The inputs are read at the start of an instruction, the same as for Execute next
+	if (control_unit.timing_signal() == 0) {
+		if (!prepare_registers(ctx))
+			return JSValueMakeNull(ctx);
+		if (!computer.registers.R)
+			queue_highlight(computer.registers.PC);
+	}
+
+	bool halt;
+	bool done = control_unit.tick(halt);
+	std::pair<int, uint16_t> data_change;
+	if (control_unit.data_change(data_change))
+		refresh_builder.mark_row_dirty(data_change.first);
+	queue_refresh();
+
+	//Show the micro-operations of the clock cycle, and the number of clock cycles when the instruction is completed
+	std::string text = std::string(control_unit.micro_operations()) + " (clock cycle " + std::to_string(control_unit.instruction_cycles()) + ")";
+	if (!done)
+		queue_log(text, "rgb(0, 0, 0)");
+	else {
+		store_history(halt, control_unit.before(), data_change);
+		serve_devices();
+		text += ", completed in " + std::to_string(control_unit.instruction_cycles()) + " clock cycles.";
+		if (halt) {
+			queue_log(text + " Execution finished.", "rgb(10, 110, 10)");
+			finished = true;
+		}
+		else
+			queue_log(text, "rgb(0, 0, 0)");
+	}
+
+	return JSValueMakeNull(ctx);
+}
+
+//Start executing the program on the worker thread until it halts or it is paused
+//MyApp::OnUpdate shows the state that the worker publishes while it runs
+JSValueRef start_run(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	if (finished || worker.busy())
+		return JSValueMakeNull(ctx);
+
+	//The worker executes whole instructions, so an instruction that Next cycle has started is completed first
+	if (control_unit.timing_signal() != 0 && complete_instruction()) {
+		queue_log("Execution finished.", "rgb(10, 110, 10)");
+		finished = true;
+		return JSValueMakeNull(ctx);
+	}
+
+	if (prepare_registers(ctx)) {
+		//The GUI is refreshed from the published state while the worker runs, so it starts with the current state
+		{
+			std::lock_guard<std::mutex> lock(published.mutex);
+			published.halted = false;
+			published.registers = computer.registers;
+			published.previous = history.previous(computer.registers);
+			std::memcpy(published.memory, computer.memory, sizeof(published.memory));
+			published.last_row = (render_queue.highlight ? render_queue.highlight_row : highlighted_row);
+			published.steps = 0;
+			published.breakpoint = false;
+			published.first = history.first();
+			published.position = history.position();
+			published.end = history.end();
+		}
+		run_start = history.position();
+		first_slice = true;
+		worker.start(run_slice);
+		queue_log("Running...", "rgb(0, 0, 0)");
+	}
+
+	return JSValueMakeNull(ctx);
+}
+
+//Pause the program that is running on the worker thread, Execute all continues it from the same state
+JSValueRef pause_run(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	if (!worker.busy())
+		return JSValueMakeNull(ctx);
+
+	if (!stop_run())
+		queue_log("Paused after " + std::to_string(published.steps) + " instructions.", "rgb(0, 0, 0)");
+	queue_refresh();
+
+	return JSValueMakeNull(ctx);
+}
+
+//Stop the program that is running on the worker thread and go back to the step where it has been started
+JSValueRef cancel_run(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	if (!worker.busy())
+		return JSValueMakeNull(ctx);
+
+	stop_run();
+	std::vector<int> changed_rows;
+	bool rewound = history.seek(computer, run_start, changed_rows);
+	for (size_t i = 0; i < changed_rows.size(); i++)
+		refresh_builder.mark_row_dirty(changed_rows[i]);
+	queue_highlight(history.position() > history.first() ? history.previous(computer.registers).PC : -1);
+	queue_refresh();
+	if (rewound)
+		queue_log("Execution cancelled.", "rgb(0, 0, 0)");
+	else
+		queue_log("Execution cancelled, the state before it is no longer in the history.", "rgb(110, 10, 10)");
+	finished = false;
 
 	return JSValueMakeNull(ctx);
 }
 
 //Go to the previous state
 JSValueRef previous_state(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
-	JSStringRef script;
-	std::string command, result;
-
-	//If the IR vector (or any other register vector) has less than 3 elements, then a previous state doesn't exist
-	if (IR.size() <= 2) {
-		command = "document.getElementById('log').innerHTML = 'No previous state exists.';document.getElementById('log').style.color = 'rgb(110, 10, 10)';";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-		JSStringRelease(script);
+	stop_run();
+	//If Next cycle has started an instruction, going back undoes its clock cycles
+	if (abort_instruction()) {
+		queue_log("", "");
+		queue_highlight(history.position() > history.first() ? history.previous(computer.registers).PC : -1);
+		return JSValueMakeNull(ctx);
+	}
+	if (!assembled || history.position() <= history.first()) {
+		queue_log("No previous state exists.", "rgb(110, 10, 10)");
 		return JSValueMakeNull(ctx);
 	}
 
 	//Clear the message log
-	command = "document.getElementById('log').innerHTML = '';";
-	//Remove the highlight from the current memory line
-	command += "document.getElementsByClassName('memoryRow')[" + std::to_string(PC[PC.size() - 2]) + "].style.backgroundColor = 'initial';";
-
-	//Remove the last element from each of the register vectors
-	IR.pop_back();
-	AC.pop_back();
-	DR.pop_back();
-	PC.pop_back();
-	AR.pop_back();
-	MAR.pop_back();
-	data[DATA_CHANGE.back().first] = DATA_CHANGE.back().second;
-	DATA_CHANGE.pop_back();
-	TR.pop_back();
-	I.pop_back();
-	E.pop_back();
-	R.pop_back();
-	IEN.pop_back();
-	FGI.pop_back();
-	FGO.pop_back();
-	INPR.pop_back();
-	OUTR.pop_back();
-
-	//Add the highlight to the previous memory line
-	command += "document.getElementsByClassName('memoryRow')[" + std::to_string(PC[PC.size() - 2]) + "].style.backgroundColor = 'rgb(220, 255, 220)';";
-	command += "document.getElementsByClassName('memoryRow')[" + std::to_string(PC[PC.size() - 2]) + "].scrollIntoView(false);";
-	script = JSStringCreateWithUTF8CString(command.c_str());
-	JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-	
-	//Change the 'finished' variable in javascript, which indicates whether the program has executed until it has reached a halt (For the Execute all button)
-	command = "finished = false;";
-	script = JSStringCreateWithUTF8CString(command.c_str());
-	JSEvaluateScript(ctx, script, 0, 0, 0, 0);
+	queue_log("", "");
 
-	refreshVariablesCommand(command);
+	//Undo the last step
+	std::vector<int> changed_rows;
+	history.pop(computer, changed_rows);
+	for (size_t i = 0; i < changed_rows.size(); i++)
+		refresh_builder.mark_row_dirty(changed_rows[i]);
 
-	script = JSStringCreateWithUTF8CString(command.c_str());
-	JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-	
-	JSStringRelease(script);
+	//Move the highlight to the previous memory line
+	queue_highlight(history.previous(computer.registers).PC);
+
+	//The program hasn't reached a halt in the previous state (For the Execute all button)
+	finished = false;
+
+	queue_refresh();
+
+	return JSValueMakeNull(ctx);
+}
+
+//Go to the executed step given as the first argument (used by the timeline slider)
+JSValueRef seek_step(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	if (!assembled || argumentCount < 1 || !JSValueIsNumber(ctx, arguments[0]))
+		return JSValueMakeNull(ctx);
+
+	//Moving the timeline pauses a running program
+	stop_run();
+	abort_instruction();
+	double step = JSValueToNumber(ctx, arguments[0], 0);
+	std::vector<int> changed_rows;
+	if (step < 0 || !history.seek(computer, uint64_t(step), changed_rows)) {
+		queue_log("The step is out of range.", "rgb(110, 10, 10)");
+		return JSValueMakeNull(ctx);
+	}
+	for (size_t i = 0; i < changed_rows.size(); i++)
+		refresh_builder.mark_row_dirty(changed_rows[i]);
+
+	//Clear the message log and move the highlight to the last executed memory line
+	queue_log("", "");
+	queue_highlight(history.previous(computer.registers).PC);
+	finished = false;
+
+	queue_refresh();
 
 	return JSValueMakeNull(ctx);
 }
@@ -826,8 +857,7 @@ std::string exec(const char* cmd) {
 
 //The load file function
 JSValueRef show_load_file(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
-	JSStringRef script;
-	std::string command = "", address;
+	std::string address;
 
 	#if defined(_WIN32) || defined(_WIN64)
 		//A Windows CMD command that runs the powershell script for opening a load file dialog box
@@ -837,97 +867,54 @@ JSValueRef show_load_file(JSContextRef ctx, JSObjectRef function, JSObjectRef th
 		address = exec("zenity --file-selection");
 	#endif
 
-	if (address == "***Failed***") {
-		command = "log.innerHTML = 'Failed to load file.';log.style.color = 'rgb(110, 10, 10)';";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
+	if (address == "***Failed***")
+		queue_log("Failed to load file.", "rgb(110, 10, 10)");
+	//A memory image is loaded straight into the computer, as if it had been assembled (the code table isn't changed)
+	else if (address != "Cancel" && is_image_address(address)) {
+		stop_run();
+		control_unit.reset();
+		reset_devices();
+		std::string error_text;
+		if (!load_image(address, computer, symbols, source_map, error_text))
+			queue_log(error_text, "rgb(110, 10, 10)");
+		else {
+			history.start(computer);
+			refresh_builder.mark_row_dirty(0);
+			refresh_builder.mark_row_dirty(4095);
+			refresh_builder.mark_registers_dirty();
+			queue_highlight(-1);
+			queue_refresh();
+			assembled = true;
+			finished = false;
+			queue_log("Memory image successfully loaded.", "rgb(10, 110, 10)");
+		}
 	}
 	//If the user doesn't cancel opening a file
 	else if (address != "Cancel") {
-		std::ifstream code_file(address);
-		std::vector<std::vector<std::string>> result;
-		std::vector<std::string> current_line;
-		std::string tmp, line_label, line_instruction, line_comment;
-		//Get each line of the file and store it in tmp
-		while(getline(code_file, tmp)) {
-			if (tmp.empty())
-				continue;
-			current_line.clear();
-			//Check whether a slash exists, if it does then separate the comment section
-			if (tmp.find('/') != std::string::npos) {
-				line_comment = tmp.substr(tmp.find('/'));
-				tmp.erase(tmp.find('/'), std::string::npos);
-			}
-			else
-				line_comment = "";
-			//All parts of the instruction, excluding the comment section, should be capitalized
-			std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::toupper);
-			//Check for double spaces and illegal(useless) characters and remove them
-			int i = 0;
-			while (i < tmp.size()) {
-				if (i + 1 < tmp.size() && tmp[i] == ' ' && tmp[i + 1] == ' ')
-					tmp.erase(i, 1);
-				else if (('0' > tmp[i] || tmp[i] > '9') && ('A' > tmp[i] || tmp[i] > 'Z') && tmp[i] != ',' && tmp[i] != ' ' && tmp[i] != '-')
-					tmp.erase(i, 1);
-				else
-					i++;
-			}
-			//Check whether a comma exists, if it does then separate the label section
-			if (tmp.find(',') != std::string::npos) {
-				line_label = tmp.substr(0, tmp.find(',') + 1);
-				tmp.erase(0, tmp.find(',') + 1);
-			}
-			else
-				line_label = "";
-			//What's left of the current line would be the instruction itself
-			line_instruction = tmp;
-			current_line.push_back(line_label);
-			current_line.push_back(line_instruction);
-			current_line.push_back(line_comment);
-			//Add the current line to the rest
-			result.push_back(current_line);
-		}
-		code_file.close();
-		//If more than 5000 lines of code exist, throw an error
-		if (result.size() > 5000) {
-			command = "log.innerHTML = 'The file contains more than 5000 lines.';log.style.color = 'rgb(110, 10, 10)';";
-			script = JSStringCreateWithUTF8CString(command.c_str());
-			JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-		}
+		std::vector<SourceLine> result;
+		std::string error_text;
+		//Split each line of the file into its label, instruction and comment sections, a file with more than 5000 lines of
+		//code is rejected as soon as its 5001st line is read
+		if (!load_source_file(address, result, error_text, 5000))
+			queue_log(error_text, "rgb(110, 10, 10)");
 		else {
-			//Store the data from the file into the code table in the GUI
-			for (int i = 0; i < result.size(); i++) {
-				command = "document.getElementsByClassName('rowLabelInput')[" + std::to_string(i) + "].value = '" + result[i][0] + "';";
-				script = JSStringCreateWithUTF8CString(command.c_str());
-				JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-				command = "document.getElementsByClassName('rowInstructionInput')[" + std::to_string(i) + "].value = '" + result[i][1] + "';";
-				script = JSStringCreateWithUTF8CString(command.c_str());
-				JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-				command = "document.getElementsByClassName('rowCommentInput')[" + std::to_string(i) + "].value = '" + result[i][2] + "';";
-				script = JSStringCreateWithUTF8CString(command.c_str());
-				JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-			}
-			command = "log.innerHTML = 'File successfully loaded.';log.style.color = 'rgb(10, 110, 10)';";
-			script = JSStringCreateWithUTF8CString(command.c_str());
-			JSEvaluateScript(ctx, script, 0, 0, 0, 0);
+			//Store the data from the file into the copy of the code table, and fetch the visible rows of the code table again
+			for (size_t i = 0; i < result.size(); i++)
+				source.set_line(i, result[i]);
+			queue_script("codeTable.refresh();");
+			queue_log("File successfully loaded.", "rgb(10, 110, 10)");
 		}
 	}
 	//If the user cancels opening a file
-	else {
-		command = "log.innerHTML = 'Load cancelled.';log.style.color = 'rgb(0, 0, 0)';";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-	}
-
-	JSStringRelease(script);
+	else
+		queue_log("Load cancelled.", "rgb(0, 0, 0)");
 
 	return JSValueMakeNull(ctx);
 }
 
 //The save file function
 JSValueRef show_save_file(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
-	JSStringRef script;
-	std::string command = "", address;
+	std::string address;
 
 	#if defined(_WIN32) || defined(_WIN64)
 		//A Windows CMD command that runs the powershell script for opening a load file dialog box
@@ -937,51 +924,70 @@ JSValueRef show_save_file(JSContextRef ctx, JSObjectRef function, JSObjectRef th
 		address = exec("zenity --file-selection --save");
 	#endif
 
-	if (address == "***Failed***") {
-		command = "log.innerHTML = 'Failed to save file.';log.style.color = 'rgb(110, 10, 10)';";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
-	}
+	if (address == "***Failed***")
+		queue_log("Failed to save file.", "rgb(110, 10, 10)");
 	//If the user doesn't cancel opening a file
 	else if (address != "Cancel") {
 		std::ofstream code_file(address);
-		std::string result, line_label, line_instruction, line_comment;
-		//Fetch each line of code from the table in the GUI
-		for (int i = 0; i < 5000; i++) {
-			command = "document.getElementsByClassName('rowLabelInput')[" + std::to_string(i) + "].value.toString()";
-			script = JSStringCreateWithUTF8CString(command.c_str());
-			result = std::string(String(JSString(JSValueToStringCopy(ctx, JSEvaluateScript(ctx, script, 0, 0, 0, 0), 0))).utf8().data());
-			line_label = result;
-			command = "document.getElementsByClassName('rowInstructionInput')[" + std::to_string(i) + "].value.toString()";
-			script = JSStringCreateWithUTF8CString(command.c_str());
-			result = std::string(String(JSString(JSValueToStringCopy(ctx, JSEvaluateScript(ctx, script, 0, 0, 0, 0), 0))).utf8().data());
-			line_instruction = result;
-			command = "document.getElementsByClassName('rowcommentInput')[" + std::to_string(i) + "].value.toString()";
-			script = JSStringCreateWithUTF8CString(command.c_str());
-			result = std::string(String(JSString(JSValueToStringCopy(ctx, JSEvaluateScript(ctx, script, 0, 0, 0, 0), 0))).utf8().data());
-			line_comment = result;
+		//The copy of the code table is always up to date, so it doesn't have to be fetched from the GUI
+		const std::vector<SourceLine> &code_lines = source.lines();
+		for (size_t i = 0; i < code_lines.size(); i++) {
 			//If the line is not empty, then store it in the file
-			if (!line_instruction.empty()) {
-				code_file << line_label;
+			if (!code_lines[i].instruction.empty()) {
+				code_file << code_lines[i].label;
 				code_file << "\t";
-				code_file << line_instruction;
+				code_file << code_lines[i].instruction;
 				code_file << "\t";
-				code_file << line_comment;
+				code_file << code_lines[i].comment;
 				code_file << "\n";
 			}
 		}
 		code_file.close();
-		command = "log.innerHTML = 'File successfully saved.';log.style.color = 'rgb(10, 110, 10)';";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
+		queue_log("File successfully saved.", "rgb(10, 110, 10)");
 	}
-	else {
-		command = "log.innerHTML = 'Save cancelled.';log.style.color = 'rgb(0, 0, 0)';";
-		script = JSStringCreateWithUTF8CString(command.c_str());
-		JSEvaluateScript(ctx, script, 0, 0, 0, 0);
+	else
+		queue_log("Save cancelled.", "rgb(0, 0, 0)");
+
+	return JSValueMakeNull(ctx);
+}
+
+//Save the current state of the computer as a memory image (right after Assemble, that is the assembled program)
+JSValueRef show_save_image(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
+	stop_run();
+	if (!assembled) {
+		queue_log("No data has been assembled.", "rgb(110, 10, 10)");
+		return JSValueMakeNull(ctx);
+	}
+	//The registers are only consistent between instructions
+	if (control_unit.timing_signal() != 0) {
+		queue_log("The current instruction must be completed first.", "rgb(110, 10, 10)");
+		return JSValueMakeNull(ctx);
 	}
 
-	JSStringRelease(script);
+	std::string address;
+
+	#if defined(_WIN32) || defined(_WIN64)
+		//A Windows CMD command that runs the powershell script for opening a save file dialog box
+		address = exec("powershell -WindowStyle hidden -executionpolicy bypass -file savefiledialog-mano.ps1");
+	#else
+		//A Linux terminal command that runs the script for opening a save file dialog box
+		address = exec("zenity --file-selection --save");
+	#endif
+
+	std::string error_text;
+	if (address == "***Failed***")
+		queue_log("Failed to save file.", "rgb(110, 10, 10)");
+	else if (address == "Cancel")
+		queue_log("Save cancelled.", "rgb(0, 0, 0)");
+	else {
+		//The image can only be loaded again with its extension
+		if (!is_image_address(address))
+			address += ".mano";
+		if (save_image(address, computer, symbols, source_map, error_text))
+			queue_log("Memory image successfully saved.", "rgb(10, 110, 10)");
+		else
+			queue_log(error_text, "rgb(110, 10, 10)");
+	}
 
 	return JSValueMakeNull(ctx);
 }
@@ -1005,9 +1011,44 @@ void MyApp::Run() {
 	app_->Run();
 }
 
-void MyApp::OnUpdate() {}
+void MyApp::OnUpdate() {
+	take_published();
+	if (!render_queue.refresh && !render_queue.highlight && !render_queue.log && render_queue.script.empty())
+		return;
+
+	//Turn the changes of this frame into a single script
+	std::string command = render_queue.script;
+	render_queue.script.clear();
+	if (render_queue.highlight) {
+		highlight_memory_row(command, render_queue.highlight_row);
+		render_queue.highlight = false;
+	}
+	if (render_queue.refresh) {
+		//While the worker thread runs, the computer belongs to it and the GUI is refreshed from the state that it has published
+		if (worker.busy()) {
+			std::lock_guard<std::mutex> lock(published.mutex);
+			refresh_builder.refresh(command, published.registers, published.previous, published.first, published.position, published.end);
+		}
+		else
+			refreshVariablesCommand(command);
+		render_queue.refresh = false;
+	}
+	if (render_queue.log) {
+		command += "log.textContent = '" + escape_js(render_queue.log_text) + "';";
+		if (!render_queue.log_color.empty())
+			command += "log.style.color = '" + render_queue.log_color + "';";
+		render_queue.log = false;
+	}
+
+	auto scoped_context = overlay_->view()->LockJSContext();
+	JSContextRef ctx = (*scoped_context);
+	JSStringRef script = JSStringCreateWithUTF8CString(command.c_str());
+	JSEvaluateScript(ctx, script, 0, 0, 0, 0);
+	JSStringRelease(script);
+}
 
 void MyApp::OnClose(ultralight::Window* window) {
+	worker.stop();
 	app_->Quit();
 }
 
@@ -1054,6 +1095,100 @@ void MyApp::OnDOMReady(ultralight::View* caller, uint64_t frame_id, bool is_main
 	JSStringRelease(name3);
 	JSStringRelease(name4);
 	JSStringRelease(name5);
+
+	JSStringRef name6 = JSStringCreateWithUTF8CString("startRun");
+	JSObjectRef func6 = JSObjectMakeFunctionWithCallback(ctx, name6, start_run);
+
+	JSObjectSetProperty(ctx, globalObj, name6, func6, 0, 0);
+
+	JSStringRelease(name6);
+
+	JSStringRef name7 = JSStringCreateWithUTF8CString("seekStep");
+	JSObjectRef func7 = JSObjectMakeFunctionWithCallback(ctx, name7, seek_step);
+
+	JSObjectSetProperty(ctx, globalObj, name7, func7, 0, 0);
+
+	JSStringRelease(name7);
+
+	JSStringRef name8 = JSStringCreateWithUTF8CString("editCodeRow");
+	JSObjectRef func8 = JSObjectMakeFunctionWithCallback(ctx, name8, edit_code_row);
+
+	JSObjectSetProperty(ctx, globalObj, name8, func8, 0, 0);
+
+	JSStringRelease(name8);
+
+	JSStringRef name9 = JSStringCreateWithUTF8CString("pauseRun");
+	JSObjectRef func9 = JSObjectMakeFunctionWithCallback(ctx, name9, pause_run);
+
+	JSObjectSetProperty(ctx, globalObj, name9, func9, 0, 0);
+
+	JSStringRelease(name9);
+
+	JSStringRef name10 = JSStringCreateWithUTF8CString("cancelRun");
+	JSObjectRef func10 = JSObjectMakeFunctionWithCallback(ctx, name10, cancel_run);
+
+	JSObjectSetProperty(ctx, globalObj, name10, func10, 0, 0);
+
+	JSStringRelease(name10);
+
+	JSStringRef name11 = JSStringCreateWithUTF8CString("getCodeRows");
+	JSObjectRef func11 = JSObjectMakeFunctionWithCallback(ctx, name11, get_code_rows);
+
+	JSObjectSetProperty(ctx, globalObj, name11, func11, 0, 0);
+
+	JSStringRelease(name11);
+
+	JSStringRef name12 = JSStringCreateWithUTF8CString("getMemoryRows");
+	JSObjectRef func12 = JSObjectMakeFunctionWithCallback(ctx, name12, get_memory_rows);
+
+	JSObjectSetProperty(ctx, globalObj, name12, func12, 0, 0);
+
+	JSStringRelease(name12);
+
+	JSStringRef name13 = JSStringCreateWithUTF8CString("executeCycle");
+	JSObjectRef func13 = JSObjectMakeFunctionWithCallback(ctx, name13, execute_cycle);
+
+	JSObjectSetProperty(ctx, globalObj, name13, func13, 0, 0);
+
+	JSStringRelease(name13);
+
+	JSStringRef name14 = JSStringCreateWithUTF8CString("showSaveImage");
+	JSObjectRef func14 = JSObjectMakeFunctionWithCallback(ctx, name14, show_save_image);
+
+	JSObjectSetProperty(ctx, globalObj, name14, func14, 0, 0);
+
+	JSStringRelease(name14);
+
+	JSStringRef name15 = JSStringCreateWithUTF8CString("toggleBreakpoint");
+	JSObjectRef func15 = JSObjectMakeFunctionWithCallback(ctx, name15, toggle_breakpoint);
+
+	JSObjectSetProperty(ctx, globalObj, name15, func15, 0, 0);
+
+	JSStringRelease(name15);
+
+	JSStringRef name16 = JSStringCreateWithUTF8CString("setCondition");
+	JSObjectRef func16 = JSObjectMakeFunctionWithCallback(ctx, name16, set_condition);
+
+	JSObjectSetProperty(ctx, globalObj, name16, func16, 0, 0);
+
+	JSStringRelease(name16);
+
+	JSStringRef name17 = JSStringCreateWithUTF8CString("feedInput");
+	JSObjectRef func17 = JSObjectMakeFunctionWithCallback(ctx, name17, feed_input);
+
+	JSObjectSetProperty(ctx, globalObj, name17, func17, 0, 0);
+
+	JSStringRelease(name17);
+
+	JSStringRef name18 = JSStringCreateWithUTF8CString("setDevices");
+	JSObjectRef func18 = JSObjectMakeFunctionWithCallback(ctx, name18, set_devices);
+
+	JSObjectSetProperty(ctx, globalObj, name18, func18, 0, 0);
+
+	JSStringRelease(name18);
+
+	//The tables can only fetch their rows after the functions above have been defined
+	queue_script("codeTable.resize();memoryTable.resize();");
 }
 
 void MyApp::OnChangeCursor(ultralight::View* caller, Cursor cursor) {
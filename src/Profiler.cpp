@@ -0,0 +1,171 @@
+#include "Profiler.h"
+#include "Decode.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+//The label of each address (empty for the addresses without a label)
+static std::vector<std::string> address_labels(const SymbolTable &symbols) {
+	std::vector<std::string> labels(4096);
+	symbols.for_each([&](uint32_t key, int address) {
+		if (address >= 0 && address < 4096)
+			labels[address] = SymbolTable::unpack(key);
+	});
+	return labels;
+}
+
+//Format an address as 3 HEX digits
+static std::string hex_address(int address) {
+	char hex[8];
+	snprintf(hex, sizeof(hex), "%03X", address);
+	return hex;
+}
+
+Profiler::Profiler() : pc_(0), r_(false) {
+	clear();
+}
+
+void Profiler::start(const Computer &computer) {
+	clear();
+	pc_ = (computer.registers.PC & 0x0FFF);
+	r_ = computer.registers.R;
+}
+
+void Profiler::clear() {
+	std::memset(address_counts_, 0, sizeof(address_counts_));
+	std::memset(operation_counts_, 0, sizeof(operation_counts_));
+	interrupts_ = 0;
+	steps_ = 0;
+	back_edges_.clear();
+	frames_.assign(1, Frame{-1, 0, 0});
+	children_.clear();
+	current_frame_ = 0;
+	depth_ = 0;
+}
+
+void Profiler::call(uint16_t entry) {
+	if (depth_ == PROFILER_MAX_DEPTH)
+		return;
+	uint64_t key = (uint64_t(current_frame_) << 12) | entry;
+	std::unordered_map<uint64_t, int>::iterator child = children_.find(key);
+	if (child == children_.end()) {
+		frames_.push_back(Frame{current_frame_, entry, 0});
+		child = children_.insert(std::make_pair(key, int(frames_.size() - 1))).first;
+	}
+	current_frame_ = child->second;
+	depth_++;
+}
+
+void Profiler::record(const Computer &computer) {
+	const Registers &registers = computer.registers;
+	uint16_t pc = (registers.PC & 0x0FFF);
+	steps_++;
+	//The interrupt cycle calls the service routine, which stores the return address at 0
+	if (r_) {
+		interrupts_++;
+		call(0);
+		frames_[current_frame_].steps++;
+	}
+	else {
+		address_counts_[pc_]++;
+		frames_[current_frame_].steps++;
+		uint8_t operation = decode_table()[registers.IR];
+		operation_counts_[operation]++;
+		//BSA stores the return address at the target and continues after it
+		if (operation == OP_BSA || operation == OP_BSA_I)
+			call((pc - 1) & 0x0FFF);
+		//A subroutine returns with a BUN I through the word that holds its return address
+		else if (operation == OP_BUN_I && depth_ > 0 && frames_[current_frame_].entry == (registers.IR & 0x0FFF)) {
+			current_frame_ = frames_[current_frame_].parent;
+			depth_--;
+		}
+		//The other jumps backwards close a loop
+		else if ((operation == OP_BUN || operation == OP_BUN_I) && pc <= pc_)
+			back_edges_[(uint32_t(pc_) << 12) | pc]++;
+	}
+	pc_ = pc;
+	r_ = registers.R;
+}
+
+uint64_t Profiler::address_count(int address) const {
+	return address_counts_[address];
+}
+
+uint64_t Profiler::operation_count(int operation) const {
+	return operation_counts_[operation];
+}
+
+uint64_t Profiler::interrupts() const {
+	return interrupts_;
+}
+
+uint64_t Profiler::steps() const {
+	return steps_;
+}
+
+std::vector<BackEdge> Profiler::back_edges() const {
+	std::vector<BackEdge> result;
+	for (const std::pair<const uint32_t, uint64_t> &edge : back_edges_)
+		result.push_back(BackEdge{uint16_t(edge.first >> 12), uint16_t(edge.first & 0x0FFF), edge.second});
+	std::sort(result.begin(), result.end(), [](const BackEdge &a, const BackEdge &b) {
+		return a.count != b.count ? a.count > b.count : (a.from != b.from ? a.from < b.from : a.to < b.to);
+	});
+	return result;
+}
+
+void Profiler::write_csv(std::ostream &out, const int source_map[4096], const SymbolTable &symbols) const {
+	std::vector<std::string> labels = address_labels(symbols);
+	out << "type,address,target,line,name,count\n";
+	for (int address = 0; address < 4096; address++)
+		if (address_counts_[address] != 0)
+			out << "address," << hex_address(address) << ",," << source_map[address] << "," << labels[address] << "," << address_counts_[address] << "\n";
+	for (int operation = 0; operation <= OP_NOP; operation++)
+		if (operation_counts_[operation] != 0)
+			out << "operation,,,," << operation_name(operation) << "," << operation_counts_[operation] << "\n";
+	if (interrupts_ != 0)
+		out << "operation,,,,INTERRUPT," << interrupts_ << "\n";
+	for (const BackEdge &edge : back_edges())
+		out << "back_edge," << hex_address(edge.from) << "," << hex_address(edge.to) << "," << source_map[edge.from] << "," << labels[edge.to] << "," << edge.count << "\n";
+}
+
+void Profiler::write_collapsed(std::ostream &out, const SymbolTable &symbols) const {
+	std::vector<std::string> labels = address_labels(symbols);
+	//The name of each frame is built from the name of its parent, which always comes before it
+	std::vector<std::string> names(frames_.size());
+	for (size_t i = 0; i < frames_.size(); i++) {
+		const Frame &frame = frames_[i];
+		if (frame.parent < 0)
+			names[i] = "main";
+		else {
+			std::string name = labels[frame.entry];
+			if (name.empty())
+				name = (frame.entry == 0 ? "interrupt" : hex_address(frame.entry));
+			names[i] = names[frame.parent] + ";" + name;
+		}
+		if (frame.steps != 0)
+			out << names[i] << " " << frame.steps << "\n";
+	}
+}
+
+void Profiler::write_report(std::ostream &out, const int source_map[4096], const SymbolTable &symbols, size_t limit) const {
+	std::vector<std::string> labels = address_labels(symbols);
+	std::vector<BackEdge> edges = back_edges();
+	out << "Hot loops:\n";
+	if (edges.empty())
+		out << "  none\n";
+	for (size_t i = 0; i < edges.size() && i < limit; i++) {
+		const BackEdge &edge = edges[i];
+		//The steps of the loop are the steps of the addresses from the target of the back-edge to the BUN
+		uint64_t loop_steps = 0;
+		for (int address = edge.to; address <= edge.from; address++)
+			loop_steps += address_counts_[address];
+		char share[16];
+		snprintf(share, sizeof(share), "%.1f", steps_ == 0 ? 0.0 : 100.0 * double(loop_steps) / double(steps_));
+		out << "  " << hex_address(edge.to);
+		if (!labels[edge.to].empty())
+			out << " (" << labels[edge.to] << ")";
+		out << " line " << source_map[edge.to] << " <- " << hex_address(edge.from) << " line " << source_map[edge.from] << ": "
+			<< edge.count << " iterations, " << share << "% of the steps\n";
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "Assembler.h"
+#include "Computer.h"
+#include "Decode.h"
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+//The maximum depth of the call stacks that the profiler keeps track of, deeper calls are counted in their caller
+#define PROFILER_MAX_DEPTH 256
+
+//A loop that has been found by the profiler: a BUN at the address from jumped back to the address to
+struct BackEdge {
+	uint16_t from, to;
+	uint64_t count;
+};
+
+//Collects an execution profile of a program: how many times each memory address and each operation has been executed,
+//the hot back-edges (a BUN that jumps backwards closes a loop, e.g. one that is counted by ISZ) and the number of steps that
+//are spent in each call stack of subroutines
+//A call is a BSA (or the interrupt cycle), and it returns when a BUN I jumps through the word that the call has stored the
+//return address in
+//The profiler is fed by Computer::run as an observer, so the fast engines have no overhead when it isn't used:
+//	profiler.start(computer);
+//	computer.run(max_steps, 0, steps, [&](const std::pair<int, uint16_t> &, bool) {profiler.record(computer);});
+class Profiler {
+	public:
+		Profiler();
+
+		//Clear the profile and start from the current state of the computer
+		void start(const Computer &computer);
+
+		//Record the step that the computer has just executed
+		void record(const Computer &computer);
+
+		//The number of times that the instruction at an address has been executed
+		uint64_t address_count(int address) const;
+
+		//The number of times that an operation (see Decode.h) has been executed
+		uint64_t operation_count(int operation) const;
+
+		//The number of interrupt cycles
+		uint64_t interrupts() const;
+
+		//The number of recorded steps (instructions and interrupt cycles)
+		uint64_t steps() const;
+
+		//The back-edges that have been taken, the hottest first
+		std::vector<BackEdge> back_edges() const;
+
+		//Write the profile as CSV, with one record for each executed address, operation and back-edge:
+		//	type,address,target,line,name,count
+		//line is the source line of the address (from the source map of the assembler, -1 if it isn't known) and name is
+		//the label of the address (the target of a back-edge) or the mnemonic of an operation
+		void write_csv(std::ostream &out, const int source_map[4096], const SymbolTable &symbols) const;
+
+		//Write the steps of each call stack in the collapsed format of flame graph tools (e.g. "main;SUB;OUT 42"), the
+		//frames are named after the labels of the subroutines
+		void write_collapsed(std::ostream &out, const SymbolTable &symbols) const;
+
+		//Write a short report of the hottest loops (at most limit of them), with their source lines and their share of
+		//the steps
+		void write_report(std::ostream &out, const int source_map[4096], const SymbolTable &symbols, size_t limit) const;
+
+	protected:
+		//Clear the counters and the call stacks
+		void clear();
+
+		//A node in the tree of call stacks, entry is the address of the word that the call stores the return address in
+		struct Frame {
+			int parent;
+			uint16_t entry;
+			uint64_t steps;
+		};
+
+		//Enter the call with the given entry from the current frame
+		void call(uint16_t entry);
+
+		uint64_t address_counts_[4096];
+		uint64_t operation_counts_[OP_NOP + 1];
+		uint64_t interrupts_, steps_;
+		//Keyed by (from << 12) | to
+		std::unordered_map<uint32_t, uint64_t> back_edges_;
+
+		//The tree of call stacks (the first frame is the root), and the children of each frame keyed by
+		//(parent << 12) | entry
+		std::vector<Frame> frames_;
+		std::unordered_map<uint64_t, int> children_;
+		int current_frame_, depth_;
+
+		//The PC and the R flag before the step that is recorded next
+		uint16_t pc_;
+		bool r_;
+};
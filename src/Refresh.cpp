@@ -0,0 +1,82 @@
+#include "Refresh.h"
+#include <algorithm>
+#include <bitset>
+#include <cstdio>
+
+RefreshBuilder::RefreshBuilder() : dirty_first_(4096), dirty_last_(-1) {}
+
+void RefreshBuilder::mark_row_dirty(int row) {
+	dirty_first_ = std::min(dirty_first_, row);
+	dirty_last_ = std::max(dirty_last_, row);
+}
+
+void RefreshBuilder::mark_registers_dirty() {
+	for (int i = 0; i < 30; i++)
+		shown_registers_[i] = "";
+}
+
+void RefreshBuilder::refresh_register(std::string &command, int cell, const char *id, bool is_input, unsigned value, int bits) {
+	std::string binary = std::bitset<16>(value).to_string().substr(16 - bits);
+	if (!is_input && shown_registers_[cell] == binary)
+		return;
+	shown_registers_[cell] = binary;
+	char hex[8];
+	snprintf(hex, sizeof(hex), "%0*X", (bits + 3) / 4, value);
+	command += std::string("document.getElementById('") + id + "')." + (is_input ? "value" : "innerHTML") + " = '" + binary + "';";
+	command += std::string("document.getElementById('") + id + "HEX').innerHTML = '" + hex + "';";
+}
+
+void RefreshBuilder::refresh(std::string &command, const Registers &current, const Registers &previous, uint64_t first, uint64_t position, uint64_t end) {
+	refresh_register(command, 0, "IR", false, current.IR, 16);
+	refresh_register(command, 1, "I", false, current.I, 1);
+	refresh_register(command, 2, "AC", false, current.AC, 16);
+	refresh_register(command, 3, "DR", false, current.DR, 16);
+	refresh_register(command, 4, "PC", false, current.PC, 12);
+	refresh_register(command, 5, "AR", false, current.AR, 12);
+	refresh_register(command, 6, "MAR", false, current.MAR, 16);
+	refresh_register(command, 7, "E", false, current.E, 1);
+	refresh_register(command, 8, "TR", false, current.TR, 16);
+	refresh_register(command, 9, "INPR", true, current.INPR, 8);
+	refresh_register(command, 10, "OUTR", false, current.OUTR, 8);
+	refresh_register(command, 11, "R", false, current.R, 1);
+	refresh_register(command, 12, "IEN", false, current.IEN, 1);
+	refresh_register(command, 13, "FGI", true, current.FGI, 1);
+	refresh_register(command, 14, "FGO", true, current.FGO, 1);
+
+	refresh_register(command, 15, "preIR", false, previous.IR, 16);
+	refresh_register(command, 16, "preI", false, previous.I, 1);
+	refresh_register(command, 17, "preAC", false, previous.AC, 16);
+	refresh_register(command, 18, "preDR", false, previous.DR, 16);
+	refresh_register(command, 19, "prePC", false, previous.PC, 12);
+	refresh_register(command, 20, "preAR", false, previous.AR, 12);
+	refresh_register(command, 21, "preMAR", false, previous.MAR, 16);
+	refresh_register(command, 22, "preE", false, previous.E, 1);
+	refresh_register(command, 23, "preTR", false, previous.TR, 16);
+	refresh_register(command, 24, "preINPR", false, previous.INPR, 8);
+	refresh_register(command, 25, "preOUTR", false, previous.OUTR, 8);
+	refresh_register(command, 26, "preR", false, previous.R, 1);
+	refresh_register(command, 27, "preIEN", false, previous.IEN, 1);
+	refresh_register(command, 28, "preFGI", false, previous.FGI, 1);
+	refresh_register(command, 29, "preFGO", false, previous.FGO, 1);
+
+	//Fetch the visible rows of the memory table again, if any of the changed lines is visible
+	if (dirty_first_ <= dirty_last_) {
+		command += "memoryTable.update(" + std::to_string(dirty_first_) + ", " + std::to_string(dirty_last_) + ");";
+		dirty_first_ = 4096;
+		dirty_last_ = -1;
+	}
+
+	//Update the timeline slider
+	command += "timeline.min = " + std::to_string(first) + ";timeline.max = " + std::to_string(end) + ";timeline.value = " + std::to_string(position) + ";";
+	command += "timelineLabel.innerHTML = '" + std::to_string(position) + " / " + std::to_string(end) + "';";
+}
+
+void memory_rows(std::string &rows, const uint16_t *memory, size_t first, size_t count, const Breakpoints &breakpoints) {
+	for (size_t i = first; i < first + count; i++) {
+		if (i > first)
+			rows += ROW_SEPARATOR;
+		rows += std::bitset<16>(memory[i]).to_string() + FIELD_SEPARATOR;
+		for (int kind = BREAK_EXECUTE; kind <= BREAK_WRITE; kind++)
+			rows += (breakpoints.has(BreakpointKind(kind), int(i)) ? '1' : '0');
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "Breakpoints.h"
+#include "Computer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//The separators that are used for transferring the rows of the tables between javascript and c++ in a single string
+#define FIELD_SEPARATOR '\x1F'
+#define ROW_SEPARATOR '\x1E'
+
+//Builds the javascript commands that refresh the register table, the memory table and the timeline of the GUI
+//It remembers the values that the register table shows and the memory lines that have changed, so that only the changed
+//cells and lines are written
+//It doesn't depend on the GUI, so ManoBench measures the same work as the GUI does after each step
+class RefreshBuilder {
+	public:
+		RefreshBuilder();
+
+		//Mark a memory line as changed, so that it is updated in the memory table on the next refresh
+		void mark_row_dirty(int row);
+
+		//Mark every register as changed, so that the next refresh rewrites the whole register table
+		void mark_registers_dirty();
+
+		//Add the commands for updating the changed values of the register table, the memory table and the timeline with
+		//the given state to command
+		void refresh(std::string &command, const Registers &current, const Registers &previous, uint64_t first, uint64_t position, uint64_t end);
+
+	protected:
+		//Add the commands for updating a cell of the register table (and its HEX cell) to command, if its value has changed
+		//since the last refresh
+		//The FGI, FGO and INPR cells are inputs that the user may have edited, so they are always updated
+		void refresh_register(std::string &command, int cell, const char *id, bool is_input, unsigned value, int bits);
+
+		//The range of memory lines that have changed since the memory table was last refreshed (dirty_first_ > dirty_last_
+		//if no line has changed)
+		int dirty_first_, dirty_last_;
+
+		//The binary values that are currently shown in the register table (the current values followed by the previous ones)
+		std::string shown_registers_[30];
+};
+
+//Add the rows of the memory table from first to first + count to rows, as getMemoryRows() returns them
+//The binary values are separated by ROW_SEPARATOR, each one is followed by FIELD_SEPARATOR and the execute, read and write
+//breakpoints of the line as three 0/1 digits
+void memory_rows(std::string &rows, const uint16_t *memory, size_t first, size_t count, const Breakpoints &breakpoints);
@@ -0,0 +1,96 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t thread_count) : next_queue_(0), pending_(0), queued_(0), stopping_(false) {
+	if (thread_count == 0)
+		thread_count = std::thread::hardware_concurrency();
+	if (thread_count == 0)
+		thread_count = 1;
+	for (size_t i = 0; i < thread_count; i++)
+		queues_.emplace_back(new Queue());
+	for (size_t i = 0; i < thread_count; i++)
+		threads_.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+	wait();
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	work_available_.notify_all();
+	for (std::thread &thread : threads_)
+		thread.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+	Queue &queue = *queues_[next_queue_++ % queues_.size()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		pending_++;
+		queued_++;
+	}
+	work_available_.notify_one();
+}
+
+void ThreadPool::wait() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	work_done_.wait(lock, [this] {return pending_ == 0;});
+}
+
+size_t ThreadPool::size() const {
+	return threads_.size();
+}
+
+bool ThreadPool::take(size_t index, std::function<void()> &task) {
+	//The newest task of this worker's own queue
+	{
+		Queue &queue = *queues_[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			return true;
+		}
+	}
+	//The oldest task of another worker's queue
+	for (size_t i = 1; i < queues_.size(); i++) {
+		Queue &queue = *queues_[(index + i) % queues_.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::work(size_t index) {
+	std::function<void()> task;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			work_available_.wait(lock, [this] {return stopping_ || queued_ > 0;});
+			if (queued_ == 0)
+				return;
+			//Claim one of the queued tasks, so that the other workers don't wait for it
+			queued_--;
+		}
+		//A claimed task is always in one of the queues (it may be taken by another worker first, but then that worker's
+		//own claim is left for this one)
+		while (!take(index, task))
+			std::this_thread::yield();
+		task();
+		task = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			pending_--;
+			if (pending_ == 0)
+				work_done_.notify_all();
+		}
+	}
+}
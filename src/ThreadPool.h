@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//A pool of worker threads with work stealing
+//Each worker has its own queue of tasks: it takes the newest task from its own queue, and when that's empty it takes the
+//oldest task from the queue of another worker, so long and short tasks are balanced across the threads
+class ThreadPool {
+	public:
+		//A thread count of 0 means one thread for each core
+		explicit ThreadPool(size_t thread_count = 0);
+
+		//Wait for all of the tasks and stop the threads
+		~ThreadPool();
+
+		//Add a task, the tasks are spread across the queues of the workers in turn
+		void submit(std::function<void()> task);
+
+		//Wait until all of the submitted tasks have finished
+		void wait();
+
+		//The number of worker threads
+		size_t size() const;
+
+	protected:
+		struct Queue {
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		//The loop of a worker thread
+		void work(size_t index);
+
+		//Take a task from the queue of the given worker, or steal one from another worker
+		//Returns false if all of the queues are empty
+		bool take(size_t index, std::function<void()> &task);
+
+		std::vector<std::unique_ptr<Queue>> queues_;
+		std::vector<std::thread> threads_;
+		std::atomic<size_t> next_queue_;
+
+		//The number of submitted tasks that haven't finished yet, the workers sleep while there is nothing to do
+		std::mutex mutex_;
+		std::condition_variable work_available_, work_done_;
+		size_t pending_;
+		size_t queued_;
+		bool stopping_;
+};
@@ -0,0 +1,314 @@
+#include "Trace.h"
+#include <cstring>
+
+//The bits of the changes of a record, the registers that change in most steps come first so that they fit in one byte
+#define TRACE_STEP (1 << 0)
+#define TRACE_PC (1 << 1)
+#define TRACE_AR (1 << 2)
+#define TRACE_MAR (1 << 3)
+#define TRACE_IR (1 << 4)
+#define TRACE_AC (1 << 5)
+#define TRACE_DR (1 << 6)
+#define TRACE_TR (1 << 7)
+#define TRACE_INPR (1 << 8)
+#define TRACE_OUTR (1 << 9)
+#define TRACE_FLAGS (1 << 10)
+#define TRACE_MEMORY (1 << 11)
+#define TRACE_CHANGES ((1 << 12) - 1)
+
+//The largest possible record, the buffer is written to the file before it has less room than this
+#define TRACE_MAX_RECORD 64
+
+//The number of words in the header of a trace: "MTRC", the version, the registers and the memory
+#define TRACE_HEADER_WORDS (4 + 15 + 4096)
+
+//The 1 bit registers packed into a byte
+static uint8_t pack_flags(const Registers &registers) {
+	return uint8_t(registers.I | (registers.E << 1) | (registers.R << 2) | (registers.IEN << 3) | (registers.FGI << 4) | (registers.FGO << 5));
+}
+
+static void unpack_flags(uint8_t flags, Registers &registers) {
+	registers.I = (flags & 1);
+	registers.E = ((flags >> 1) & 1);
+	registers.R = ((flags >> 2) & 1);
+	registers.IEN = ((flags >> 3) & 1);
+	registers.FGI = ((flags >> 4) & 1);
+	registers.FGO = ((flags >> 5) & 1);
+}
+
+//The bits of the registers that differ between from and to
+static uint32_t register_changes(const Registers &from, const Registers &to) {
+	uint32_t changes = 0;
+	if (from.PC != to.PC) changes |= TRACE_PC;
+	if (from.AR != to.AR) changes |= TRACE_AR;
+	if (from.MAR != to.MAR) changes |= TRACE_MAR;
+	if (from.IR != to.IR) changes |= TRACE_IR;
+	if (from.AC != to.AC) changes |= TRACE_AC;
+	if (from.DR != to.DR) changes |= TRACE_DR;
+	if (from.TR != to.TR) changes |= TRACE_TR;
+	if (from.INPR != to.INPR) changes |= TRACE_INPR;
+	if (from.OUTR != to.OUTR) changes |= TRACE_OUTR;
+	if (pack_flags(from) != pack_flags(to)) changes |= TRACE_FLAGS;
+	return changes;
+}
+
+std::string register_differences(const Registers &a, const Registers &b) {
+	std::string names;
+	const char *flag_names[6] = {"I", "E", "R", "IEN", "FGI", "FGO"};
+	uint8_t flags = uint8_t(pack_flags(a) ^ pack_flags(b));
+	const std::pair<bool, const char *> differences[] = {{a.IR != b.IR, "IR"}, {a.AC != b.AC, "AC"}, {a.DR != b.DR, "DR"},
+		{a.PC != b.PC, "PC"}, {a.AR != b.AR, "AR"}, {a.MAR != b.MAR, "MAR"}, {a.TR != b.TR, "TR"}, {a.INPR != b.INPR, "INPR"},
+		{a.OUTR != b.OUTR, "OUTR"}};
+	for (const std::pair<bool, const char *> &difference : differences)
+		if (difference.first)
+			names += (names.empty() ? "" : " ") + std::string(difference.second);
+	for (int i = 0; i < 6; i++)
+		if ((flags >> i) & 1)
+			names += (names.empty() ? "" : " ") + std::string(flag_names[i]);
+	return names;
+}
+
+TraceWriter::TraceWriter() : file_(nullptr), used_(0), failed_(false), steps_(0) {}
+
+TraceWriter::~TraceWriter() {
+	std::string error_text;
+	close(error_text);
+}
+
+bool TraceWriter::open(const std::string &address, const Computer &computer, std::string &error_text) {
+	close(error_text);
+	file_ = std::fopen(address.c_str(), "wb");
+	if (file_ == nullptr) {
+		error_text = "Failed to create the trace file.";
+		return false;
+	}
+	used_ = 0;
+	failed_ = false;
+	steps_ = 0;
+	last_ = computer.registers;
+
+	//The header is written in little endian 16 bit words
+	const Registers &registers = computer.registers;
+	const uint16_t words[19] = {'M' | ('T' << 8), 'R' | ('C' << 8), TRACE_VERSION & 0xFFFF, TRACE_VERSION >> 16,
+		registers.IR, registers.AC, registers.DR, registers.PC, registers.AR, registers.MAR, registers.TR,
+		registers.I, registers.E, registers.R, registers.IEN, registers.FGI, registers.FGO, registers.INPR, registers.OUTR};
+	for (int i = 0; i < TRACE_HEADER_WORDS; i++) {
+		uint16_t word = (i < 19 ? words[i] : computer.memory[i - 19]);
+		buffer_[used_++] = uint8_t(word);
+		buffer_[used_++] = uint8_t(word >> 8);
+		if (used_ > TRACE_BUFFER_SIZE - TRACE_MAX_RECORD)
+			flush();
+	}
+	return true;
+}
+
+void TraceWriter::record(const Registers &before, const std::pair<int, uint16_t> &data_change, const Computer &computer) {
+	if (file_ == nullptr)
+		return;
+	if (register_changes(last_, before) != 0)
+		write_record(false, before, -1, 0);
+	int address = (computer.memory[data_change.first] != data_change.second ? data_change.first : -1);
+	write_record(true, computer.registers, address, address == -1 ? 0 : computer.memory[address]);
+	steps_++;
+}
+
+bool TraceWriter::close(std::string &error_text) {
+	if (file_ == nullptr)
+		return true;
+	flush();
+	if (std::fclose(file_) != 0)
+		failed_ = true;
+	file_ = nullptr;
+	if (failed_) {
+		error_text = "Failed to write the trace file.";
+		return false;
+	}
+	return true;
+}
+
+void TraceWriter::write_record(bool step, const Registers &to, int address, uint16_t value) {
+	uint32_t changes = register_changes(last_, to) | (step ? TRACE_STEP : 0) | (address != -1 ? TRACE_MEMORY : 0);
+	put_varint(changes);
+	if (changes & TRACE_PC) {
+		//The zigzag encoding keeps small negative differences small
+		int32_t difference = int32_t(to.PC) - int32_t(last_.PC);
+		put_varint((uint32_t(difference) << 1) ^ uint32_t(difference >> 31));
+	}
+	if (changes & TRACE_AR) put_varint(to.AR);
+	if (changes & TRACE_MAR) put_varint(to.MAR);
+	if (changes & TRACE_IR) put_varint(to.IR);
+	if (changes & TRACE_AC) put_varint(to.AC);
+	if (changes & TRACE_DR) put_varint(to.DR);
+	if (changes & TRACE_TR) put_varint(to.TR);
+	if (changes & TRACE_INPR) put_varint(to.INPR);
+	if (changes & TRACE_OUTR) put_varint(to.OUTR);
+	if (changes & TRACE_FLAGS) buffer_[used_++] = pack_flags(to);
+	if (changes & TRACE_MEMORY) {
+		put_varint(uint32_t(address));
+		put_varint(value);
+	}
+	last_ = to;
+	if (used_ > TRACE_BUFFER_SIZE - TRACE_MAX_RECORD)
+		flush();
+}
+
+void TraceWriter::put_varint(uint32_t value) {
+	while (value >= 0x80) {
+		buffer_[used_++] = uint8_t(value | 0x80);
+		value >>= 7;
+	}
+	buffer_[used_++] = uint8_t(value);
+}
+
+void TraceWriter::flush() {
+	if (used_ != 0 && std::fwrite(buffer_, 1, used_, file_) != used_)
+		failed_ = true;
+	used_ = 0;
+}
+
+TraceReader::TraceReader() : file_(nullptr), begin_(0), end_(0), steps_(0) {}
+
+TraceReader::~TraceReader() {
+	if (file_ != nullptr)
+		std::fclose(file_);
+}
+
+bool TraceReader::open(const std::string &address, std::string &error_text) {
+	if (file_ != nullptr)
+		std::fclose(file_);
+	file_ = std::fopen(address.c_str(), "rb");
+	begin_ = end_ = 0;
+	steps_ = 0;
+	error_text_.clear();
+	if (file_ == nullptr) {
+		error_text = "Failed to load file.";
+		return false;
+	}
+
+	uint16_t words[TRACE_HEADER_WORDS];
+	for (int i = 0; i < TRACE_HEADER_WORDS; i++) {
+		uint8_t low, high;
+		if (!get_byte(low) || !get_byte(high)) {
+			error_text = (i < 2 ? "The file isn't a trace." : "The trace is damaged.");
+			return false;
+		}
+		words[i] = uint16_t(low | (high << 8));
+		if (i == 1 && (words[0] != ('M' | ('T' << 8)) || words[1] != ('R' | ('C' << 8)))) {
+			error_text = "The file isn't a trace.";
+			return false;
+		}
+	}
+	if ((words[2] | (uint32_t(words[3]) << 16)) != TRACE_VERSION) {
+		error_text = "The trace has an unsupported version.";
+		return false;
+	}
+	Registers &registers = registers_;
+	registers.IR = words[4];
+	registers.AC = words[5];
+	registers.DR = words[6];
+	registers.PC = words[7];
+	registers.AR = words[8];
+	registers.MAR = words[9];
+	registers.TR = words[10];
+	bool valid = (registers.PC < 4096 && registers.AR < 4096 && words[17] < 256 && words[18] < 256);
+	uint8_t flags = 0;
+	for (int i = 0; i < 6; i++) {
+		valid = valid && words[11 + i] <= 1;
+		flags |= uint8_t((words[11 + i] & 1) << i);
+	}
+	unpack_flags(flags, registers);
+	registers.INPR = uint8_t(words[17]);
+	registers.OUTR = uint8_t(words[18]);
+	if (!valid) {
+		error_text = "The trace is damaged.";
+		return false;
+	}
+	std::memcpy(memory_, words + 19, sizeof(memory_));
+	return true;
+}
+
+bool TraceReader::next(TraceRecord &record) {
+	uint32_t changes, value;
+	if (file_ == nullptr || !error_text_.empty())
+		return false;
+	//The end of the file is only expected between two records
+	uint8_t first;
+	if (!get_byte(first))
+		return false;
+	//Put the byte back, it is the first byte of the changes
+	begin_--;
+	bool valid = get_varint(changes) && changes <= TRACE_CHANGES;
+	Registers registers = registers_;
+	if (valid && (changes & TRACE_PC)) {
+		valid = get_varint(value) && value < 2 * 4096;
+		int32_t difference = int32_t(value >> 1) ^ -int32_t(value & 1);
+		registers.PC = uint16_t(int32_t(registers.PC) + difference);
+		valid = valid && registers.PC < 4096;
+	}
+	uint16_t *words[6] = {&registers.AR, &registers.MAR, &registers.IR, &registers.AC, &registers.DR, &registers.TR};
+	for (int i = 0; i < 6; i++)
+		if (valid && (changes & (TRACE_AR << i))) {
+			valid = get_varint(value) && value <= (i == 0 ? 4095u : 0xFFFFu);
+			*words[i] = uint16_t(value);
+		}
+	if (valid && (changes & TRACE_INPR)) {
+		valid = get_varint(value) && value <= 0xFF;
+		registers.INPR = uint8_t(value);
+	}
+	if (valid && (changes & TRACE_OUTR)) {
+		valid = get_varint(value) && value <= 0xFF;
+		registers.OUTR = uint8_t(value);
+	}
+	if (valid && (changes & TRACE_FLAGS)) {
+		uint8_t flags = 0;
+		valid = get_byte(flags) && flags < 64;
+		if (valid)
+			unpack_flags(flags, registers);
+	}
+	record.address = -1;
+	record.value = 0;
+	if (valid && (changes & TRACE_MEMORY)) {
+		valid = get_varint(value) && value < 4096;
+		record.address = int(value);
+		valid = valid && get_varint(value) && value <= 0xFFFF;
+		record.value = uint16_t(value);
+	}
+	if (!valid) {
+		error_text_ = "The trace is damaged after " + std::to_string(steps_) + " steps.";
+		return false;
+	}
+
+	registers_ = registers;
+	if (record.address != -1)
+		memory_[record.address] = record.value;
+	record.step = (changes & TRACE_STEP) != 0;
+	record.registers = registers;
+	if (record.step)
+		steps_++;
+	return true;
+}
+
+bool TraceReader::get_byte(uint8_t &byte) {
+	if (begin_ == end_) {
+		begin_ = 0;
+		end_ = std::fread(buffer_, 1, TRACE_BUFFER_SIZE, file_);
+		if (end_ == 0)
+			return false;
+	}
+	byte = buffer_[begin_++];
+	return true;
+}
+
+bool TraceReader::get_varint(uint32_t &value) {
+	value = 0;
+	//A 32 bit value takes at most 5 bytes
+	for (int shift = 0; shift < 35; shift += 7) {
+		uint8_t byte;
+		if (!get_byte(byte))
+			return false;
+		value |= uint32_t(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
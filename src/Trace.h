@@ -0,0 +1,113 @@
+#pragma once
+#include "Computer.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+//The version of the trace format, a trace with another version isn't read
+#define TRACE_VERSION 1
+
+//The size of the buffers of the trace files
+#define TRACE_BUFFER_SIZE (64 * 1024)
+
+//A trace (a .trace file) records what a run has done, so that it can be replayed or compared with another run offline
+//It starts with the state of the computer, followed by a delta record for each step:
+//	"MTRC", version (32 bits), the registers and the memory (16 bits each, the 1 and 8 bit registers in a 16 bit word too)
+//	records: [changes] [the changed registers] [flags] [address, value]
+//The changes are a varint with a bit for each changed register, whether the flags (I, E, R, IEN, FGI, FGO) or a memory
+//word have changed, and whether the record is a step; a record that isn't a step is a change of the inputs (FGI, INPR...)
+//between two steps, made by the user or an input device
+//The PC register is stored as the zigzag varint of its difference from the previous PC, so an ordinary step takes one byte
+//for it, and the other values are varints; most steps take 6-10 bytes
+
+//A record of a trace, with the state after it
+struct TraceRecord {
+	//Whether the record is an executed step (otherwise, it is a change of the inputs between two steps)
+	bool step;
+	Registers registers;
+	//The memory word that the step has changed (-1 if none) and its new value
+	int address;
+	uint16_t value;
+};
+
+//The names of the registers that differ between a and b, separated by spaces (empty if none differs)
+std::string register_differences(const Registers &a, const Registers &b);
+
+//Streams the steps of a run to a trace file through a buffer
+class TraceWriter {
+	public:
+		TraceWriter();
+		~TraceWriter();
+
+		TraceWriter(const TraceWriter &) = delete;
+		TraceWriter &operator=(const TraceWriter &) = delete;
+
+		//Create the trace file and write the current state of the computer to it
+		//Returns false and sets error_text if the file can't be created
+		bool open(const std::string &address, const Computer &computer, std::string &error_text);
+
+		//Record a step, given the register values before it, the memory word that it might have changed (as reported by
+		//Computer::step) and the computer after it
+		//If the registers have been changed since the last step (e.g. a new input), the change is recorded first
+		void record(const Registers &before, const std::pair<int, uint16_t> &data_change, const Computer &computer);
+
+		//Write the rest of the buffer and close the file
+		//Returns false and sets error_text if any write has failed
+		bool close(std::string &error_text);
+
+		//The number of recorded steps
+		uint64_t steps() const { return steps_; }
+
+	protected:
+		void write_record(bool step, const Registers &to, int address, uint16_t value);
+		void put_varint(uint32_t value);
+		void flush();
+
+		std::FILE *file_;
+		uint8_t buffer_[TRACE_BUFFER_SIZE];
+		size_t used_;
+		bool failed_;
+		Registers last_;
+		uint64_t steps_;
+};
+
+//Reads a trace file through a buffer and replays its records on a copy of the state
+class TraceReader {
+	public:
+		TraceReader();
+		~TraceReader();
+
+		TraceReader(const TraceReader &) = delete;
+		TraceReader &operator=(const TraceReader &) = delete;
+
+		//Open a trace file and read the state that it starts from
+		//Returns false and sets error_text if the file can't be read or isn't a trace
+		bool open(const std::string &address, std::string &error_text);
+
+		//Read the next record and apply it to the state
+		//Returns false at the end of the trace, or if the trace is damaged (then error_text() isn't empty)
+		bool next(TraceRecord &record);
+
+		//The state after the last record (the initial state before the first record)
+		const Registers &registers() const { return registers_; }
+		const uint16_t *memory() const { return memory_; }
+
+		//The number of steps that have been read
+		uint64_t steps() const { return steps_; }
+
+		const std::string &error_text() const { return error_text_; }
+
+	protected:
+		//Read bytes from the buffer, refilling it when it runs out, returns false at the end of the file
+		bool get_byte(uint8_t &byte);
+		bool get_varint(uint32_t &value);
+
+		std::FILE *file_;
+		uint8_t buffer_[TRACE_BUFFER_SIZE];
+		size_t begin_, end_;
+		Registers registers_;
+		uint16_t memory_[4096];
+		uint64_t steps_;
+		std::string error_text_;
+};
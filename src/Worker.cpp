@@ -0,0 +1,53 @@
+#include "Worker.h"
+
+Worker::Worker() : busy_(false), stop_requested_(false), exiting_(false) {
+	thread_ = std::thread(&Worker::work, this);
+}
+
+Worker::~Worker() {
+	stop();
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		exiting_ = true;
+	}
+	changed_.notify_all();
+	thread_.join();
+}
+
+void Worker::start(std::function<bool()> slice) {
+	stop();
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		slice_ = std::move(slice);
+		stop_requested_ = false;
+		busy_ = true;
+	}
+	changed_.notify_all();
+}
+
+void Worker::stop() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	stop_requested_ = true;
+	changed_.wait(lock, [this] {return !busy_;});
+}
+
+bool Worker::busy() const {
+	return busy_;
+}
+
+void Worker::work() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		changed_.wait(lock, [this] {return exiting_ || busy_;});
+		if (exiting_)
+			return;
+		//The slices run without the lock, stop() only waits for the current slice to finish
+		lock.unlock();
+		while (!stop_requested_ && slice_())
+			;
+		lock.lock();
+		slice_ = nullptr;
+		busy_ = false;
+		changed_.notify_all();
+	}
+}
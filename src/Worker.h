@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+//Runs a task on a background thread one slice at a time, so that it can be stopped between two slices
+//The task is stopped when a slice returns false or when stop() is called
+class Worker {
+	public:
+		Worker();
+
+		//Stop the task and the thread
+		~Worker();
+
+		//Start calling slice() on the worker thread, the previous task is stopped first
+		void start(std::function<bool()> slice);
+
+		//Ask the task to stop after the current slice and wait until it has stopped
+		//After this returns, the data that the task uses can be accessed from the calling thread again
+		void stop();
+
+		//Whether a task is running
+		bool busy() const;
+
+	protected:
+		//The loop of the worker thread
+		void work();
+
+		std::thread thread_;
+		std::mutex mutex_;
+		std::condition_variable changed_;
+		std::function<bool()> slice_;
+		std::atomic<bool> busy_, stop_requested_;
+		bool exiting_;
+};